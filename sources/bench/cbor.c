@@ -0,0 +1,101 @@
+/**
+ * CBOR against JSON text: encode and decode throughput on a generated document
+ *
+ * Built and run by `make bench`; the record count can be given as argument.
+ */
+#include "../utjson.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_RUNS 5 /**< Best of this many runs is reported */
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static utjson *bench_document(size_t records)
+{
+    utjson *root = utjson_createArray();
+    char name[32];
+    for (size_t i = 0; i < records; i++)
+    {
+        utjson *record = utjson_addObject(root);
+        utjson_set(record, "id", utjson_createUint64(i * 2654435761u));
+        snprintf(name, sizeof(name), "record %zu", i);
+        utjson_setString(record, "name", name);
+        utjson_setNumber(record, "score", i * 0.37 + 0.125);
+        utjson_setBool(record, "active", i % 3 == 0);
+        utjson_setNull(record, "parent");
+        utjson *tags = utjson_setArray(record, "tags");
+        for (size_t t = 0; t < 4; t++)
+        {
+            utjson_add(tags, utjson_createInt64((int64_t)(i + t) - 1000));
+        }
+        utjson *position = utjson_setObject(record, "position");
+        utjson_setNumber(position, "x", i / 7.0);
+        utjson_setNumber(position, "y", -(double)i);
+    }
+    return root;
+}
+
+static void report(const char *what, double seconds, size_t bytes)
+{
+    printf("%-22s %9.2f ms %9.1f MB/s\n", what, seconds * 1e3, bytes / seconds / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    size_t records = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+    utjson *document = bench_document(records);
+    char *text = utjson_print(document, false);
+    size_t text_length = strlen(text);
+    size_t cbor_length = 0;
+    uint8_t *cbor = utjson_toCBOR(document, &cbor_length);
+    if (!text || !cbor)
+    {
+        fprintf(stderr, "encoding failed\n");
+        return 1;
+    }
+    printf("%zu records: %zu bytes of JSON, %zu bytes of CBOR\n", records, text_length, cbor_length);
+
+    double best[5] = {1e9, 1e9, 1e9, 1e9, 1e9};
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        double start = now();
+        free(utjson_print(document, false));
+        double printed = now();
+        utjson_destruct(utjson_parseWith(text, utjson_PARSE_INTEGERS));
+        double parsed = now();
+        free(utjson_toCBOR(document, NULL));
+        double encoded = now();
+        utjson_destruct(utjson_fromCBOR(cbor, cbor_length));
+        double decoded = now();
+        utjson_arena *arena = utjson_arenaCreate(0);
+        utjson_fromCBORIn(arena, cbor, cbor_length);
+        utjson_arenaDestroy(arena);
+        double arena_decoded = now();
+
+        double times[5] = {printed - start, parsed - printed, encoded - parsed, decoded - encoded,
+                           arena_decoded - decoded};
+        for (int i = 0; i < 5; i++)
+        {
+            best[i] = times[i] < best[i] ? times[i] : best[i];
+        }
+    }
+    // throughput counts the bytes of each side's own encoding
+    report("utjson_print", best[0], text_length);
+    report("utjson_parseWith", best[1], text_length);
+    report("utjson_toCBOR", best[2], cbor_length);
+    report("utjson_fromCBOR", best[3], cbor_length);
+    report("utjson_fromCBORIn", best[4], cbor_length);
+
+    free(cbor);
+    free(text);
+    utjson_destruct(document);
+    return 0;
+}
@@ -1,9 +1,13 @@
 #include "utjson.h"
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 // Test case for utjson_createNull
 void test_utjson_createNull(void)
@@ -151,6 +155,1368 @@ void test_utjson_parse_print(void)
     utjson_destruct(parsed);
 }
 
+// Test case for utjson_printTo and utjson_printLen
+void test_utjson_printTo(void)
+{
+    utjson *array = utjson_createArray();
+    for (int i = 0; i < 1000; i++)
+    {
+        utjson_addNumber(array, i);
+    }
+
+    size_t length = 0;
+    char *printed = utjson_printLen(array, false, &length);
+    assert(printed != NULL);
+    assert(length == strlen(printed));
+    assert(strncmp(printed, "[0,1,2,", 7) == 0);
+
+    // printTo appends to whatever the buffer already holds
+    utjson_buffer buffer = {0};
+    assert(utjson_printTo(&buffer, array, false));
+    assert(utjson_printTo(&buffer, NULL, false));
+    assert(buffer.length == length + 4);
+    assert(strncmp(buffer.data, printed, length) == 0);
+    assert(strcmp(buffer.data + length, "null") == 0);
+
+    utjson_bufferFree(&buffer);
+    free(printed);
+    utjson_destruct(array);
+}
+
+// Test case for arena-backed documents
+void test_utjson_arena(void)
+{
+    utjson_arena *arena = utjson_arenaCreate(1024);
+    assert(arena != NULL);
+
+    for (int round = 0; round < 3; round++)
+    {
+        utjson *parsed = utjson_parseInArena(arena, "{\"key\": \"value\", \"list\": [1, 2, 3]}");
+        assert(parsed != NULL);
+        assert(parsed->arena == arena);
+        assert(strcmp(utjson_asString(utjson_get(parsed, "key")), "value") == 0);
+        assert(utjson_asNumber(utjson_select(utjson_get(parsed, "list"), 2)) == 3);
+
+        utjson *list = utjson_get(parsed, "list");
+        for (int i = 0; i < 100; i++)
+        {
+            assert(utjson_addNumber(list, i)->arena == arena);
+        }
+        assert(utjson_setString(parsed, "key", "replaced")->arena == arena);
+        assert(strcmp(utjson_asString(utjson_get(parsed, "key")), "replaced") == 0);
+
+        utjson_arenaReset(arena);
+    }
+
+    utjson *object = utjson_createObjectIn(arena);
+    utjson_set(object, "flag", utjson_createBoolIn(arena, true));
+    assert(utjson_asBool(utjson_get(object, "flag")));
+    utjson_arenaDestroy(arena);
+}
+
+// Test case for arrays beyond 65535 elements
+void test_utjson_large_array(void)
+{
+    utjson *array = utjson_createArray();
+    assert(utjson_arrayReserve(array, 1000) == array);
+    assert(array->allocated == 1000);
+
+    size_t count = 70000;
+    for (size_t i = 0; i < count; i++)
+    {
+        utjson_addNumber(array, (double)i);
+    }
+    assert(array->used == count);
+    assert(utjson_asNumber(utjson_select(array, 69999)) == 69999.0);
+    assert(utjson_select(array, count) == NULL);
+
+    size_t sum = 0;
+    utjson *item = NULL;
+    utjson_arrayFor(array, item, index)
+    {
+        sum += (size_t)utjson_asNumber(item);
+    }
+    assert(sum == count * (count - 1) / 2);
+    utjson_destruct(array);
+}
+
+// Test case for the indexed parser against the recursive one
+void test_utjson_parse_indexed(void)
+{
+    utjson *source = utjson_createArray();
+    for (int i = 0; i < 200; i++)
+    {
+        utjson *item = utjson_addObject(source);
+        utjson_setNumber(item, "id", i);
+        utjson_setString(item, "text", "a [b] {c}: d, e");
+        utjson_setBool(item, "even", i % 2 == 0);
+        utjson_setNull(item, "none");
+        utjson_setArray(item, "empty");
+    }
+    char *text = utjson_print(source, true);
+    assert(strlen(text) > utjson_PARSE_INDEX_THRESHOLD);
+
+    utjson *indexed = utjson_parseWith(text, utjson_PARSE_INDEXED);
+    utjson *recursive = utjson_parseWith(text, utjson_PARSE_RECURSIVE);
+    assert(indexed != NULL && recursive != NULL);
+    char *indexed_text = utjson_print(indexed, true);
+    char *recursive_text = utjson_print(recursive, true);
+    assert(strcmp(indexed_text, text) == 0);
+    assert(strcmp(recursive_text, text) == 0);
+
+    // every engine rejects the same inputs, whatever their size
+    char *malformed[] = {"", "[1, 2", "{\"a\" 1}", "[1 2]", "[1,]", "tru", "[12x]", "{\"a\":1,}", "{\"a\":1",
+                         "{\"a\":1 \"b\":2}", "[[1]", "{\"a\":[1}", "[1}", "{\"a\":1]", "[,1]", "{,}",
+                         "{\"a\":1,,\"b\":2}"};
+    unsigned engines[] = {utjson_PARSE_DEFAULT, utjson_PARSE_RECURSIVE, utjson_PARSE_INDEXED};
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+    {
+        for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++)
+        {
+            assert(utjson_parseWith(malformed[i], engines[e]) == NULL);
+        }
+    }
+
+    free(indexed_text);
+    free(recursive_text);
+    free(text);
+    utjson_destruct(indexed);
+    utjson_destruct(recursive);
+    utjson_destruct(source);
+}
+
+// Test case for utjson_parseInPlace
+void test_utjson_parseInPlace(void)
+{
+    char buffer[] = "{\"name\": \"value\", \"list\": [\"a\", \"b\"]}trailing";
+    size_t length = strlen(buffer) - strlen("trailing");
+
+    for (unsigned engine = 0; engine < 2; engine++)
+    {
+        char source[sizeof(buffer)];
+        memcpy(source, buffer, sizeof(buffer));
+        utjson *parsed = engine ? utjson_parseWith(source, utjson_PARSE_INDEXED | utjson_PARSE_IN_PLACE)
+                                : utjson_parseInPlace(source, length);
+        assert(parsed != NULL);
+
+        utjson *name = utjson_get(parsed, "name");
+        assert(name != NULL);
+        assert(name->string >= source && name->string < source + length);
+        assert(name->name >= source && name->name < source + length);
+        assert(strcmp(name->string, "value") == 0);
+        assert(strcmp(utjson_asString(utjson_select(utjson_get(parsed, "list"), 1)), "b") == 0);
+
+        // replacing a borrowed member releases only what the tree owns
+        utjson_setString(parsed, "name", "owned");
+        utjson_destruct(parsed);
+    }
+}
+
+// Test case for the compact node layout and object members
+void test_utjson_compact_object(void)
+{
+    // a bare scalar must stay within one cache line
+    assert(sizeof(utjson) <= 64);
+
+    utjson *obj = utjson_createObject();
+    utjson_setNumber(obj, "a", 1);
+    utjson_setNumber(obj, "b", 2);
+    utjson_setNumber(obj, "c", 3);
+    utjson_setString(obj, "b", "two");
+    assert(utjson_asNumber(obj) == 3);
+
+    const char *names[] = {"a", "b", "c"};
+    utjson *item = NULL;
+    utjson_objectForEach(obj, item, tmp)
+    {
+        assert(strcmp(item->name, names[tmp]) == 0);
+    }
+
+    utjson *copy = utjson_clone(obj);
+    utjson_destruct(utjson_detach(utjson_get(obj, "a")));
+    assert(utjson_get(obj, "a") == NULL);
+    assert(strcmp(utjson_asString(utjson_get(obj, "b")), "two") == 0);
+    assert(utjson_asNumber(utjson_get(obj, "c")) == 3);
+
+    char *printed = utjson_print(copy, false);
+    assert(strcmp(printed, "{\"a\":1,\"b\":\"two\",\"c\":3}") == 0);
+
+    free(printed);
+    utjson_destruct(copy);
+    utjson_destruct(obj);
+}
+
+// Test case for the push parser fed in every possible pair of chunks
+void test_utjson_parser(void)
+{
+    char *json = "{\"id\": 12345, \"name\": \"chunked input\", \"ok\": true, \"tags\": [null, false, -1.5e3]}";
+    size_t length = strlen(json);
+    utjson *expected = utjson_parse(json);
+    char *expected_text = utjson_print(expected, false);
+
+    for (size_t split = 0; split <= length; split++)
+    {
+        utjson_parser *parser = utjson_parserNew(utjson_PARSE_DEFAULT);
+        assert(utjson_parserFeed(parser, json, split));
+        assert(utjson_parserFeed(parser, json + split, length - split));
+        utjson *parsed = utjson_parserFinish(parser);
+        assert(parsed != NULL);
+        char *text = utjson_print(parsed, false);
+        assert(strcmp(text, expected_text) == 0);
+        free(text);
+        utjson_destruct(parsed);
+    }
+
+    // a top-level number ends with the input
+    utjson_parser *parser = utjson_parserNew(utjson_PARSE_DEFAULT);
+    assert(utjson_parserFeed(parser, "12", 2) && utjson_parserFeed(parser, "34", 2));
+    utjson *number = utjson_parserFinish(parser);
+    assert(utjson_asNumber(number) == 1234);
+    utjson_destruct(number);
+
+    parser = utjson_parserNew(utjson_PARSE_DEFAULT);
+    assert(utjson_parserFeed(parser, "[1, 2", 5));
+    assert(utjson_parserFinish(parser) == NULL);
+
+    parser = utjson_parserNew(utjson_PARSE_DEFAULT);
+    assert(!utjson_parserFeed(parser, "[1 2]", 5));
+    assert(utjson_parserFinish(parser) == NULL);
+
+    free(expected_text);
+    utjson_destruct(expected);
+}
+
+typedef struct
+{
+    size_t events;
+    size_t containers;
+    double sum;
+} sax_counts;
+
+static utjson_sax_action count_container(void *user)
+{
+    ((sax_counts *)user)->events++;
+    ((sax_counts *)user)->containers++;
+    return utjson_SAX_CONTINUE;
+}
+
+static utjson_sax_action count_number(void *user, double value)
+{
+    ((sax_counts *)user)->events++;
+    ((sax_counts *)user)->sum += value;
+    return value < 0 ? utjson_SAX_ABORT : utjson_SAX_CONTINUE;
+}
+
+static utjson_sax_action skip_tags(void *user, const char *name, size_t length)
+{
+    ((sax_counts *)user)->events++;
+    return length == 4 && memcmp(name, "tags", 4) == 0 ? utjson_SAX_SKIP : utjson_SAX_CONTINUE;
+}
+
+static utjson_sax_action skip_container(void *user)
+{
+    (void)user;
+    return utjson_SAX_SKIP;
+}
+
+void test_utjson_parseEvents(void)
+{
+    char *json = "{\"id\": 12, \"tags\": [1, 2, {\"x\": 3}], \"list\": [4, 5]}";
+    utjson_sax sax = {
+        .start_object = count_container,
+        .start_array = count_container,
+        .number = count_number,
+    };
+    sax_counts counts = {0};
+    assert(utjson_parseEvents(json, strlen(json), &sax, &counts));
+    assert(counts.containers == 4 && counts.sum == 27 && counts.events == 10);
+
+    // a skipped member produces no events
+    sax.key = skip_tags;
+    memset(&counts, 0, sizeof(counts));
+    assert(utjson_parseEvents(json, strlen(json), &sax, &counts));
+    assert(counts.containers == 2 && counts.sum == 21 && counts.events == 8);
+
+    assert(!utjson_parseEvents("[1, -2, 3]", 10, &sax, &counts) && errno == ECANCELED);
+    assert(!utjson_parseEvents("[1, 2", 5, &sax, &counts) && errno == EINVAL);
+    assert(!utjson_parseEvents("[1 2]", 5, &sax, &counts) && errno == EINVAL);
+
+    // skipped parts are checked like the rest
+    const char *skipped[] = {"{\"tags\": [1}}", "{\"tags\": [1 2]}", "{\"tags\": {\"a\" 1}}",
+                             "{\"tags\": {\"a\": 1,}}", "{\"tags\": [tru]}", "{\"tags\": [1,]}",
+                             "{\"tags\": 12x}", "{\"tags\": [[1]}", "{\"tags\": [{\"a\":1]]}"};
+    for (size_t i = 0; i < sizeof(skipped) / sizeof(skipped[0]); i++)
+    {
+        errno = 0;
+        assert(!utjson_parseEvents(skipped[i], strlen(skipped[i]), &sax, &counts) && errno == EINVAL);
+    }
+
+    // a container skipped from its start callback ends without an event
+    utjson_sax skip_arrays = {.start_array = skip_container, .end_array = count_container, .number = count_number};
+    memset(&counts, 0, sizeof(counts));
+    char *mixed = "{\"a\": [1, [2]], \"b\": 3}";
+    assert(utjson_parseEvents(mixed, strlen(mixed), &skip_arrays, &counts));
+    assert(counts.events == 1 && counts.sum == 3);
+    mixed = "{\"a\": [1 [2]], \"b\": 3}";
+    assert(!utjson_parseEvents(mixed, strlen(mixed), &skip_arrays, &counts) && errno == EINVAL);
+}
+
+typedef struct
+{
+    size_t records;
+    size_t malformed;
+    size_t last_offset;
+    bool ordered;
+    double sum;
+} lines_counts;
+
+static bool count_line(void *user, size_t offset, utjson *document)
+{
+    lines_counts *counts = user;
+    if (counts->records && offset <= counts->last_offset)
+    {
+        counts->ordered = false;
+    }
+    counts->last_offset = offset;
+    counts->records++;
+    if (!document)
+    {
+        counts->malformed++;
+    }
+    counts->sum += utjson_asNumber(utjson_get(document, "id"));
+    utjson_destruct(document);
+    return counts->records < 100 || counts->sum < 1e15;
+}
+
+void test_utjson_parseLines(void)
+{
+    // enough records for several batches
+    utjson_buffer input = {0};
+    size_t total = 200000;
+    for (size_t id = 1; id <= total; id++)
+    {
+        char line[64];
+        int length = snprintf(line, sizeof(line), "{\"id\": %zu, \"tags\": [\"a\", \"b\"]}\n%s", id,
+                              id % 1000 ? "" : "\r\n");
+        assert(utjson_bufferReserve(&input, length));
+        memcpy(input.data + input.length, line, length);
+        input.length += length;
+    }
+
+    lines_counts counts = {.ordered = true};
+    assert(utjson_parseLines(input.data, input.length, 4, utjson_PARSE_DEFAULT, count_line, &counts));
+    assert(counts.records == total && counts.malformed == 0 && counts.ordered);
+    assert(counts.sum == (double)total * (total + 1) / 2);
+
+    memset(&counts, 0, sizeof(counts));
+    assert(utjson_parseLines(input.data, input.length, 0, utjson_PARSE_UNORDERED, count_line, &counts));
+    assert(counts.records == total && counts.sum == (double)total * (total + 1) / 2);
+
+    // the callback stops after 100 records once the sum is large
+    memset(&counts, 0, sizeof(counts));
+    counts.sum = 1e15;
+    assert(!utjson_parseLines(input.data, input.length, 4, utjson_PARSE_DEFAULT, count_line, &counts));
+    assert(errno == ECANCELED && counts.records == 100);
+
+    char *mixed = "[1]\n\n{broken\n  \n\"text\"";
+    memset(&counts, 0, sizeof(counts));
+    assert(utjson_parseLines(mixed, strlen(mixed), 1, utjson_PARSE_DEFAULT, count_line, &counts));
+    assert(counts.records == 3 && counts.malformed == 1 && counts.last_offset == 16);
+
+    utjson_bufferFree(&input);
+}
+
+void test_utjson_parseFile(void)
+{
+    char path[] = "/tmp/utjson_test_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    // no trailing NUL or newline in the file
+    char *json = "{\"name\": \"mapped\", \"list\": [1, 2, 3]}";
+    assert(write(fd, json, strlen(json)) == (ssize_t)strlen(json));
+    close(fd);
+
+    utjson *parsed = utjson_parseFile(path, utjson_PARSE_DEFAULT);
+    assert(parsed && strcmp(utjson_asString(utjson_get(parsed, "name")), "mapped") == 0);
+    assert(utjson_get(parsed, "list")->used == 3);
+    utjson_destruct(parsed);
+
+    // in place: strings borrow the mapping, the file itself is untouched
+    utjson_arena *arena = utjson_arenaCreate(0);
+    parsed = utjson_parseFileIn(arena, path, utjson_PARSE_IN_PLACE);
+    utjson *name = utjson_get(parsed, "name");
+    assert(name && (name->flags & utjson_BORROWED_STRING) && strcmp(utjson_asString(name), "mapped") == 0);
+    arena = utjson_arenaDestroy(arena);
+    parsed = utjson_parseFile(path, utjson_PARSE_INDEXED);
+    assert(parsed && utjson_asNumber(utjson_select(utjson_get(parsed, "list"), 2)) == 3);
+    utjson_destruct(parsed);
+
+    lines_counts counts = {0};
+    assert(utjson_parseLinesFile(path, 2, utjson_PARSE_DEFAULT, count_line, &counts));
+    assert(counts.records == 1 && counts.malformed == 0);
+
+    unlink(path);
+    assert(utjson_parseFile(path, utjson_PARSE_DEFAULT) == NULL && errno == ENOENT);
+}
+
+void test_utjson_parse_numbers(void)
+{
+    char *json = "[0, -0.5, 1e23, 2.2250738585072011e-308, 123456789012345678901234567890, 0.1e1, 9007199254740993]";
+    double expected[] = {0, -0.5, 1e23, 2.2250738585072011e-308, 1.2345678901234568e29, 1, 9007199254740992};
+    utjson *parsed = utjson_parseWith(json, utjson_PARSE_INDEXED);
+    assert(parsed && parsed->used == sizeof(expected) / sizeof(expected[0]));
+    for (size_t i = 0; i < parsed->used; i++)
+    {
+        assert(utjson_asNumber(utjson_select(parsed, i)) == expected[i]);
+    }
+    utjson_destruct(parsed);
+
+    // forms strtod() takes but JSON does not
+    char *invalid[] = {"[+1]", "[.5]", "[0x10]", "[inf]", "[nan]", "[1.]", "[01]", "[1e]"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        assert(utjson_parseWith(invalid[i], utjson_PARSE_INDEXED) == NULL);
+    }
+}
+
+void test_utjson_print_numbers(void)
+{
+    utjson *array = utjson_createArray();
+    double values[] = {42, -0.5, 0.1, 1e23, 123456789.125, 1e-7, 1.7976931348623157e308, 9007199254740993.0, 0.000001,
+                       5e-324, -1e-323, 1.5e-323, 5e-323};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        utjson_addNumber(array, values[i]);
+    }
+    char *text = utjson_print(array, false);
+    assert(strcmp(text, "[42,-0.5,0.1,1e+23,123456789.125,1e-7,1.7976931348623157e+308,9007199254740992,0.000001,"
+                        "5e-324,-1e-323,1.5e-323,5e-323]") == 0);
+
+    // every value reads back exactly
+    utjson *parsed = utjson_parse(text);
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        assert(utjson_asNumber(utjson_select(parsed, i)) == values[i]);
+    }
+    utjson_destruct(parsed);
+    free(text);
+
+    assert(strcmp(utjson_asString(utjson_select(array, 0)), "42") == 0);
+    assert(strcmp(utjson_asString(utjson_select(array, 2)), "0.1") == 0);
+    utjson_destruct(array);
+}
+
+void test_utjson_int64(void)
+{
+    char *json = "[9223372036854775807,-9223372036854775808,18446744073709551615,18446744073709551616,1.5,-0,9007199254740993]";
+    utjson *parsed = utjson_parseWith(json, utjson_PARSE_INTEGERS);
+    assert(parsed && parsed->used == 7);
+    assert(utjson_asInt64(utjson_select(parsed, 0)) == INT64_MAX);
+    assert(utjson_asInt64(utjson_select(parsed, 1)) == INT64_MIN);
+    assert(utjson_asUint64(utjson_select(parsed, 2)) == UINT64_MAX);
+    assert(utjson_select(parsed, 2)->flags & utjson_UNSIGNED);
+    assert(!(utjson_select(parsed, 3)->flags & utjson_INTEGER)); // too large, stays a double
+    assert(!(utjson_select(parsed, 4)->flags & utjson_INTEGER));
+    assert(!(utjson_select(parsed, 5)->flags & utjson_INTEGER));
+    assert(utjson_asInt64(utjson_select(parsed, 6)) == 9007199254740993LL);
+
+    // exact on the way out too, also for copies
+    utjson *copy = utjson_clone(parsed);
+    char *text = utjson_print(copy, false);
+    assert(strcmp(text, "[9223372036854775807,-9223372036854775808,18446744073709551615,18446744073709552000,1.5,-0,"
+                        "9007199254740993]") == 0);
+    free(text);
+    assert(strcmp(utjson_asString(utjson_select(copy, 6)), "9007199254740993") == 0);
+    utjson_destruct(copy);
+
+    errno = 0;
+    assert(utjson_asInt64(utjson_select(parsed, 2)) == INT64_MAX && errno == ERANGE);
+    errno = 0;
+    assert(utjson_asUint64(utjson_select(parsed, 1)) == 0 && errno == ERANGE);
+    assert(utjson_asInt64(utjson_select(parsed, 4)) == 1);
+    utjson_destruct(parsed);
+
+    // without the flag integers are doubles as before
+    parsed = utjson_parse("[9007199254740993]");
+    assert(!(utjson_select(parsed, 0)->flags & utjson_INTEGER) && utjson_asInt64(utjson_select(parsed, 0)) == 9007199254740992LL);
+    utjson_destruct(parsed);
+
+    utjson *object = utjson_createObject();
+    utjson_setInt64(object, "id", -42);
+    utjson_addInt64(utjson_setArray(object, "list"), 1LL << 60);
+    text = utjson_print(object, false);
+    assert(strcmp(text, "{\"id\":-42,\"list\":[1152921504606846976]}") == 0);
+    assert(utjson_asNumber(utjson_get(object, "id")) == -42 && utjson_asBool(utjson_get(object, "id")));
+    free(text);
+    utjson_destruct(object);
+}
+
+static void *intern_worker(void *pool)
+{
+    char name[24];
+    for (int i = 0; i < 1000; i++)
+    {
+        snprintf(name, sizeof(name), "k%d", i);
+        assert(utjson_internString(pool, name, strlen(name)));
+    }
+    return NULL;
+}
+
+void test_utjson_intern(void)
+{
+    utjson_intern *pool = utjson_internCreate();
+    const char *ts = utjson_internString(pool, "ts", 2);
+    assert(ts && strcmp(ts, "ts") == 0);
+    assert(utjson_internString(pool, "tsx", 2) == ts);
+    assert(utjson_internString(pool, "", 0) && utjson_internString(pool, "", 0) != ts);
+
+    // documents share the pooled names instead of owning copies
+    char first[] = "{\"ts\": 1, \"level\": \"info\", \"msg\": \"a long message that is not pooled at all\"}";
+    char second[] = "{\"level\": \"info\", \"ts\": 2}";
+    utjson *a = utjson_parseInterned(pool, first, strlen(first), utjson_PARSE_INTERN_VALUES);
+    utjson *b = utjson_parseInterned(pool, second, strlen(second), utjson_PARSE_INDEXED);
+    assert(a && b);
+    assert(utjson_get(a, "ts")->name == ts && utjson_get(b, "ts")->name == ts);
+    assert(utjson_get(a, "ts")->flags & utjson_INTERNED_NAME);
+    assert(utjson_get(a, "level")->name == utjson_get(b, "level")->name);
+    assert(utjson_asNumber(utjson_get(b, "ts")) == 2);
+
+    // short values only with utjson_PARSE_INTERN_VALUES
+    assert(utjson_get(a, "level")->string == utjson_internString(pool, "info", 4));
+    assert(utjson_get(b, "level")->string != utjson_get(a, "level")->string);
+    assert(!(utjson_get(a, "msg")->flags & utjson_BORROWED_STRING));
+
+    // replace, detach and plain names mix with pooled ones
+    assert(utjson_setInterned(b, pool, "ts", utjson_createNumber(3)));
+    assert(b->used == 2 && utjson_asNumber(utjson_get(b, "ts")) == 3);
+    utjson_set(b, "level", utjson_createString("debug"));
+    assert(b->used == 2 && !(utjson_get(b, "level")->flags & utjson_BORROWED_NAME));
+    utjson *detached = utjson_detach(utjson_get(a, "ts"));
+    assert(detached && detached->name == ts && a->used == 2 && !utjson_get(a, "ts"));
+    utjson_destruct(detached);
+    char *text = utjson_print(b, false);
+    assert(strcmp(text, "{\"level\":\"debug\",\"ts\":3}") == 0);
+    free(text);
+    utjson *copy = utjson_clone(a);
+    assert(utjson_get(copy, "level") && !(utjson_get(copy, "level")->flags & utjson_BORROWED_NAME));
+    utjson_destruct(copy);
+    utjson_destruct(a);
+    utjson_destruct(b);
+
+    // concurrent interning hands out one copy per string
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+    {
+        assert(pthread_create(&threads[i], NULL, intern_worker, pool) == 0);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    assert(utjson_internString(pool, "k999", 4) == utjson_internString(pool, "k999", 4));
+    assert(utjson_parseInterned(NULL, second, strlen(second), 0) == NULL && errno == EINVAL);
+
+    // a name from another pool still addresses the same member, small or indexed
+    utjson_intern *other = utjson_internCreate();
+    for (size_t size = 1; size <= 12; size += 11)
+    {
+        char json[256] = "{\"k\":1";
+        for (size_t i = 1; i < size; i++)
+        {
+            snprintf(json + strlen(json), sizeof(json) - strlen(json), ",\"m%zu\":%zu", i, i);
+        }
+        strcat(json, "}");
+        utjson *doc = utjson_parseInterned(pool, json, strlen(json), 0);
+        assert(utjson_setInterned(doc, other, "k", utjson_createNumber(5)));
+        assert(doc->used == size && utjson_asNumber(utjson_get(doc, "k")) == 5);
+        assert(strcmp(doc->children[0]->name, "k") == 0);
+        utjson_destruct(doc);
+    }
+    utjson_internDestroy(other);
+    utjson_internDestroy(pool);
+}
+
+void test_utjson_key(void)
+{
+    utjson_key ts = utjson_keyCompile("ts");
+    utjson_key id = utjson_keyCompile("id");
+    assert(ts.length == 2 && strcmp(ts.name, "ts") == 0);
+
+    utjson *object = utjson_parse("{\"id\": 7, \"ts\": 1}");
+    assert(utjson_getByKey(object, &ts) == utjson_get(object, "ts"));
+    assert(utjson_asNumber(utjson_getByKey(object, &id)) == 7);
+    utjson_key missing = utjson_keyCompile("value");
+    assert(!utjson_getByKey(object, &missing));
+
+    // keys and plain names address the same members
+    assert(utjson_setByKey(object, &ts, utjson_createNumber(2)));
+    assert(object->used == 2 && utjson_asNumber(utjson_get(object, "ts")) == 2);
+    assert(utjson_setByKey(object, &missing, NULL) && object->used == 3);
+    assert(utjson_IS(NULL, utjson_get(object, "value")));
+    char *text = utjson_print(object, false);
+    assert(strcmp(text, "{\"id\":7,\"ts\":2,\"value\":null}") == 0);
+    free(text);
+
+    // interned names match compiled keys
+    utjson_intern *pool = utjson_internCreate();
+    char json[] = "{\"ts\": 5}";
+    utjson *interned = utjson_parseInterned(pool, json, strlen(json), 0);
+    assert(utjson_asNumber(utjson_getByKey(interned, &ts)) == 5);
+    utjson_destruct(interned);
+    utjson_internDestroy(pool);
+
+    assert(!utjson_getByKey(utjson_get(object, "id"), &ts) && errno == EINVAL);
+    utjson_key none = utjson_keyCompile(NULL);
+    assert(!utjson_setByKey(object, &none, NULL) && errno == EINVAL);
+    utjson_destruct(object);
+}
+
+static void check_members(utjson *object, size_t count)
+{
+    char name[24];
+    assert(object->used == count);
+    for (size_t i = 0; i < count; i++)
+    {
+        snprintf(name, sizeof(name), "m%zu", i);
+        assert(utjson_asNumber(utjson_get(object, name)) == i);
+        assert(strcmp(object->children[i]->name, name) == 0);
+    }
+    assert(!utjson_get(object, "missing"));
+}
+
+void test_utjson_small_object(void)
+{
+    utjson_arena *arena = utjson_arenaCreate(0);
+    utjson *objects[] = {utjson_createObject(), utjson_createObjectIn(arena)};
+    for (size_t k = 0; k < 2; k++)
+    {
+        utjson *object = objects[k];
+        char name[24];
+        for (size_t i = 0; i < 20; i++)
+        {
+            snprintf(name, sizeof(name), "m%zu", i);
+            utjson_set(object, name, utjson_createNumberIn(object->arena, i));
+            // scanned up to the threshold, indexed past it
+            assert(!object->members == (i < utjson_OBJECT_INDEX_THRESHOLD));
+            check_members(object, i + 1);
+        }
+        // replacing keeps the slot in both forms
+        utjson_setNumber(object, "m3", 3);
+        check_members(object, 20);
+        for (size_t i = 19; i >= 10; i--)
+        {
+            snprintf(name, sizeof(name), "m%zu", i);
+            utjson_destruct(utjson_detach(utjson_get(object, name)));
+        }
+        check_members(object, 10);
+    }
+    utjson_destruct(objects[0]);
+    utjson_arenaDestroy(arena);
+
+    utjson *small = utjson_parse("{\"a\":1,\"b\":{\"c\":2},\"a\":3}");
+    assert(small->used == 2 && !small->members && utjson_asNumber(utjson_get(small, "a")) == 3);
+    utjson_destruct(utjson_detach(utjson_get(small, "a")));
+    utjson_setNumber(small, "d", 4);
+    char *text = utjson_print(small, false);
+    assert(strcmp(text, "{\"b\":{\"c\":2},\"d\":4}") == 0);
+    free(text);
+    utjson_destruct(small);
+
+    // a member set again under its own name, or moved to another one
+    for (size_t size = 6; size <= 12; size += 6)
+    {
+        utjson *object = utjson_createObject();
+        char name[24];
+        for (size_t i = 0; i < size; i++)
+        {
+            snprintf(name, sizeof(name), "k%zu", i);
+            utjson_setNumber(object, name, i);
+        }
+        utjson *member = utjson_get(object, "k5");
+        assert(utjson_set(object, "k5", member) == member);
+        assert(utjson_set(object, member->name, member) == member);
+        assert(utjson_get(object, "k5") == member && object->used == size);
+        assert(utjson_set(object, "moved", member) == member);
+        assert(!utjson_get(object, "k5") && utjson_get(object, "moved") == member && object->used == size);
+        for (size_t i = 0; i < size; i++)
+        {
+            snprintf(name, sizeof(name), "k%zu", i);
+            assert(i == 5 || utjson_asNumber(utjson_get(object, name)) == i);
+        }
+        assert(object->children[size - 1] == member);
+        utjson_destruct(object);
+    }
+}
+
+static void check_roundtrip(const char *json)
+{
+    utjson *parsed = utjson_parse((char *)json);
+    char *text = utjson_print(parsed, false);
+    assert(strcmp(text, json) == 0);
+    utjson *copy = utjson_clone(parsed);
+    char *again = utjson_print(copy, false);
+    assert(strcmp(again, json) == 0);
+    free(again);
+    free(text);
+    utjson_destruct(copy);
+    utjson_destruct(parsed);
+}
+
+void test_utjson_member_order(void)
+{
+    // names deliberately out of hash and alphabetical order, small and indexed
+    check_roundtrip("{\"z\":1,\"a\":2,\"m\":3}");
+    check_roundtrip("{\"k9\":0,\"k1\":1,\"k8\":2,\"k2\":3,\"k7\":4,\"k3\":5,\"k6\":6,\"k4\":7,\"k5\":8,\"k0\":9,"
+                    "\"x\":{\"b\":1,\"a\":2}}");
+
+    for (int size = 3; size <= 12; size += 9)
+    {
+        utjson *object = utjson_createObject();
+        char name[16];
+        for (int i = size - 1; i >= 0; i--)
+        {
+            snprintf(name, sizeof(name), "n%d", i);
+            utjson_setNumber(object, name, i);
+        }
+        // a replacement keeps the slot, a removal closes the gap, a new name goes last
+        utjson_setString(object, "n1", "one");
+        utjson_destruct(utjson_detach(utjson_get(object, "n2")));
+        utjson_destruct(utjson_detach(utjson_get(object, "n0")));
+        utjson_setNumber(object, "n2", 2);
+        char *text = utjson_print(object, false);
+        assert(strcmp(text, size == 3 ? "{\"n1\":\"one\",\"n2\":2}"
+                                       : "{\"n11\":11,\"n10\":10,\"n9\":9,\"n8\":8,\"n7\":7,\"n6\":6,\"n5\":5,"
+                                         "\"n4\":4,\"n3\":3,\"n1\":\"one\",\"n2\":2}") == 0);
+        free(text);
+        utjson_destruct(object);
+    }
+
+    // a repeated name keeps its first position and takes the last value
+    utjson *parsed = utjson_parse("{\"a\":1,\"b\":2,\"a\":3}");
+    char *text = utjson_print(parsed, false);
+    assert(strcmp(text, "{\"a\":3,\"b\":2}") == 0);
+    free(text);
+    utjson_destruct(parsed);
+}
+
+static utjson *pointer_get(utjson *root, const char *text)
+{
+    utjson_pointer *pointer = utjson_pointerCompile(text);
+    assert(pointer);
+    utjson *found = utjson_pointerGet(root, pointer);
+    utjson_pointerDestroy(pointer);
+    return found;
+}
+
+void test_utjson_pointer(void)
+{
+    // the example of RFC 6901, section 5
+    utjson *doc = utjson_parse("{\"foo\": [\"bar\", \"baz\"], \"\": 0, \"a/b\": 1, \"c%d\": 2, \"e^f\": 3, "
+                               "\"g|h\": 4, \"i\\\\j\": 5, \"k\\\"l\": 6, \" \": 7, \"m~n\": 8}");
+    assert(doc);
+    assert(pointer_get(doc, "") == doc);
+    assert(pointer_get(doc, "/foo") == utjson_get(doc, "foo"));
+    assert(strcmp(pointer_get(doc, "/foo/0")->string, "bar") == 0);
+    const char *pointers[] = {"/", "/a~1b", "/c%d", "/e^f", "/g|h", "/i\\j", "/k\"l", "/ ", "/m~0n"};
+    for (size_t i = 0; i < sizeof(pointers) / sizeof(pointers[0]); i++)
+    {
+        assert(utjson_asNumber(pointer_get(doc, pointers[i])) == i);
+    }
+    assert(!pointer_get(doc, "/foo/2") && !pointer_get(doc, "/foo/01") && !pointer_get(doc, "/foo/-"));
+    assert(!pointer_get(doc, "/missing/x") && !pointer_get(doc, "/foo/0/x"));
+    assert(!utjson_pointerCompile("foo") && errno == EINVAL);
+    assert(!utjson_pointerCompile("/a~2") && errno == EINVAL);
+    assert(!utjson_pointerCompile("/a~") && errno == EINVAL);
+
+    // set replaces members and elements, appends with "-" and creates members
+    utjson_pointer *pointer = utjson_pointerCompile("/foo/1");
+    assert(utjson_pointerSet(doc, pointer, utjson_createString("qux")));
+    assert(strcmp(pointer_get(doc, "/foo/1")->string, "qux") == 0 && utjson_get(doc, "foo")->used == 2);
+    utjson_pointerDestroy(pointer);
+    pointer = utjson_pointerCompile("/foo/-");
+    assert(utjson_pointerSet(doc, pointer, NULL) && utjson_get(doc, "foo")->used == 3);
+    utjson_pointerDestroy(pointer);
+    pointer = utjson_pointerCompile("/foo/5");
+    utjson *orphan = utjson_createNull();
+    assert(!utjson_pointerSet(doc, pointer, orphan) && errno == EINVAL);
+    utjson_destruct(orphan);
+    utjson_pointerDestroy(pointer);
+    pointer = utjson_pointerCompile("/new~1name");
+    assert(utjson_pointerSet(doc, pointer, utjson_createNumber(9)));
+    assert(utjson_asNumber(utjson_get(doc, "new/name")) == 9);
+    utjson_pointerDestroy(pointer);
+    pointer = utjson_pointerCompile("/none/x");
+    assert(!utjson_pointerSet(doc, pointer, NULL) && errno == ENOENT);
+    utjson_pointerDestroy(pointer);
+
+    char *text = utjson_print(utjson_get(doc, "foo"), false);
+    assert(strcmp(text, "[\"bar\",\"qux\",null]") == 0);
+    free(text);
+    utjson_destruct(doc);
+}
+
+// matches of query as their printed values, joined by spaces
+static char *path_text(utjson *root, const char *query)
+{
+    static char text[512];
+    utjson_path *path = utjson_pathCompile(query);
+    assert(path);
+    size_t count = 0;
+    utjson **matches = utjson_pathSelect(root, path, &count);
+    assert(matches && !matches[count]);
+    text[0] = '\0';
+    for (size_t i = 0; i < count; i++)
+    {
+        char *value = utjson_print(matches[i], false);
+        snprintf(text + strlen(text), sizeof(text) - strlen(text), "%s%s", i ? " " : "", value);
+        free(value);
+    }
+    free(matches);
+    utjson_pathDestroy(path);
+    return text;
+}
+
+static bool stop_first(void *user, utjson *match)
+{
+    *(utjson **)user = match;
+    return false;
+}
+
+void test_utjson_path(void)
+{
+    utjson *store = utjson_parseWith(
+        "{\"store\": {\"book\": ["
+        "{\"category\": \"reference\", \"author\": \"Nigel Rees\", \"title\": \"Sayings of the Century\", \"price\": 8.95},"
+        "{\"category\": \"fiction\", \"author\": \"Evelyn Waugh\", \"title\": \"Sword of Honour\", \"price\": 12.99},"
+        "{\"category\": \"fiction\", \"author\": \"Herman Melville\", \"title\": \"Moby Dick\", \"isbn\": \"0-553-21311-3\", "
+        "\"price\": 8.99},"
+        "{\"category\": \"fiction\", \"author\": \"J. R. R. Tolkien\", \"title\": \"The Lord of the Rings\", "
+        "\"isbn\": \"0-395-19395-8\", \"price\": 22.99}],"
+        "\"bicycle\": {\"color\": \"red\", \"price\": 19.95}}, \"expensive\": 10, \"ids\": [9007199254740992, 9007199254740993]}",
+        utjson_PARSE_INTEGERS);
+    assert(store);
+
+    assert(strcmp(path_text(store, "$.store.book[*].author"),
+                  "\"Nigel Rees\" \"Evelyn Waugh\" \"Herman Melville\" \"J. R. R. Tolkien\"") == 0);
+    assert(strcmp(path_text(store, "$..author"),
+                  "\"Nigel Rees\" \"Evelyn Waugh\" \"Herman Melville\" \"J. R. R. Tolkien\"") == 0);
+    assert(strcmp(path_text(store, "$.store..price"), "8.95 12.99 8.99 22.99 19.95") == 0);
+    assert(strcmp(path_text(store, "$..book[2].title"), "\"Moby Dick\"") == 0);
+    assert(strcmp(path_text(store, "$..book[-1].title"), "\"The Lord of the Rings\"") == 0);
+    assert(strcmp(path_text(store, "$..book[0,1].price"), "8.95 12.99") == 0);
+    assert(strcmp(path_text(store, "$..book[:2].price"), "8.95 12.99") == 0);
+    assert(strcmp(path_text(store, "$..book[::-2].price"), "22.99 12.99") == 0);
+    assert(strcmp(path_text(store, "$..book[1:-1].price"), "12.99 8.99") == 0);
+    // steps past the end of the array stop after the first element instead of overflowing
+    assert(strcmp(path_text(store, "$..book[1::9223372036854775807].price"), "12.99") == 0);
+    assert(strcmp(path_text(store, "$..book[2::-9223372036854775807].price"), "8.99") == 0);
+    assert(strcmp(path_text(store, "$..book[::-9223372036854775807].price"), "22.99") == 0);
+    assert(!utjson_pathCompile("$[9223372036854775808]") && !utjson_pathCompile("$[::99999999999999999999]"));
+    assert(strcmp(path_text(store, "$['store'][\"bicycle\"].color"), "\"red\"") == 0);
+    assert(strcmp(path_text(store, "$.store.bicycle[*]"), "\"red\" 19.95") == 0);
+    assert(strcmp(path_text(store, "$.store.book[5]"), "") == 0);
+
+    // filters
+    assert(strcmp(path_text(store, "$..book[?(@.isbn)].price"), "8.99 22.99") == 0);
+    assert(strcmp(path_text(store, "$..book[?(!@.isbn)].price"), "8.95 12.99") == 0);
+    assert(strcmp(path_text(store, "$..book[?(@.price < 10)].price"), "8.95 8.99") == 0);
+    assert(strcmp(path_text(store, "$..book[?(@.price > $.expensive)].price"), "12.99 22.99") == 0);
+    assert(strcmp(path_text(store, "$..book[?(@.price > 10 && @.category == 'fiction')].price"), "12.99 22.99") == 0);
+    assert(strcmp(path_text(store, "$..book[?@.category != \"fiction\" || (@.price >= 22.99)].price"), "8.95 22.99") ==
+           0);
+    assert(strcmp(path_text(store, "$.store[?(@.color == 'red')].price"), "19.95") == 0);
+    assert(strcmp(path_text(store, "$.ids[?(@ == 9007199254740993)]"), "9007199254740993") == 0);
+    assert(strcmp(path_text(store, "$.ids[?(@ <= 9007199254740992)]"), "9007199254740992") == 0);
+    assert(strcmp(path_text(store, "$..book[?(@.missing == null)]"), "") == 0);
+    assert(strcmp(path_text(store, "$..[?(@.price == 19.95)].color"), "\"red\"") == 0);
+
+    // the matches are the document's own nodes, and a callback can stop early
+    utjson_path *path = utjson_pathCompile("$..price");
+    utjson *first = NULL;
+    assert(!utjson_pathEach(store, path, stop_first, &first) && errno == ECANCELED);
+    assert(first == utjson_select(utjson_get(utjson_get(store, "store"), "book"), 0)->children[3]);
+    utjson_pathDestroy(path);
+
+    const char *malformed[] = {"store", "$.", "$[", "$[1", "$.a.[0]", "$[?(@.a)", "$[?(@..a == 1)]", "$[?(1)]",
+                               "$['a]", "$[01]", "$ x"};
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+    {
+        errno = 0;
+        assert(!utjson_pathCompile(malformed[i]) && errno == EINVAL);
+    }
+    utjson_destruct(store);
+}
+
+static char *project_text(const char *json, const char *const *texts, size_t count, unsigned flags)
+{
+    utjson_pointer *pointers[8];
+    for (size_t i = 0; i < count; i++)
+    {
+        pointers[i] = utjson_pointerCompile(texts[i]);
+        assert(pointers[i]);
+    }
+    char *source = strdup(json);
+    utjson *projection = utjson_parseProjected(source, strlen(source), (const utjson_pointer *const *)pointers, count, flags);
+    char *text = projection ? utjson_print(projection, false) : NULL;
+    utjson_destruct(projection);
+    for (size_t i = 0; i < count; i++)
+    {
+        utjson_pointerDestroy(pointers[i]);
+    }
+    free(source);
+    return text;
+}
+
+void test_utjson_parseProjected(void)
+{
+    const char *json = "{\"store\": {\"book\": [{\"title\": \"A\", \"tags\": [\"x]}\\\"\", {\"deep\": [1, 2]}]},"
+                       " {\"title\": \"B\", \"price\": 12.5}, {\"title\": \"C\"}],"
+                       " \"bicycle\": {\"color\": \"red\", \"price\": 19.95}},"
+                       " \"skipped\": [true, false, null, -1e5, \"{\"], \"expensive\": 10}";
+
+    const char *some[] = {"/store/book/1/title", "/store/bicycle", "/expensive", "/missing/x", "/store/book/0/title/x"};
+    char *text = project_text(json, some, 5, utjson_PARSE_DEFAULT);
+    assert(text && strcmp(text, "{\"store\":{\"book\":[null,{\"title\":\"B\"}],\"bicycle\":{\"color\":\"red\","
+                                "\"price\":19.95}},\"expensive\":10}") == 0);
+    free(text);
+
+    // the same in place, and a pointer past a skipped string with brackets and quotes
+    const char *after[] = {"/store/book/2", "/skipped/4"};
+    text = project_text(json, after, 2, utjson_PARSE_IN_PLACE);
+    assert(text && strcmp(text, "{\"store\":{\"book\":[null,null,{\"title\":\"C\"}]},\"skipped\":[null,null,null,"
+                                "null,\"{\"]}") == 0);
+    free(text);
+
+    // nothing matching leaves the empty root, "" keeps everything
+    const char *none[] = {"/nothing"};
+    text = project_text(json, none, 1, 0);
+    assert(text && strcmp(text, "{}") == 0);
+    free(text);
+    const char *all[] = {""};
+    text = project_text("[1,{\"a\":2}]", all, 1, 0);
+    assert(text && strcmp(text, "[1,{\"a\":2}]") == 0);
+    free(text);
+
+    // skipped and kept parts are checked as utjson_parse() checks them, and only whitespace may follow
+    const char *kept[] = {"/a"};
+    const char *malformed[] = {"{\"a\": [1, 2, \"b\": 1}", "{\"a\": \"open}", "{\"nothing\": [1, }",
+                               "{\"x\":[1,2},\"a\":3}", "{\"x\":{\"y\":1],\"a\":3}", "{\"a\":1 \"b\":2}",
+                               "{\"a\":[1 2 3]}", "{\"x\":[1 2],\"a\":3}", "{\"x\":{\"y\" 1},\"a\":3}",
+                               "{\"x\":[1,],\"a\":3}", "{\"x\":tru,\"a\":3}", "{\"x\":12x,\"a\":3}",
+                               "{\"a\":1,}", "[1,]", "{\"a\":1} garbage", "{\"a\":1}}", "[1]x", "1 2", "0[]", ""};
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++)
+    {
+        assert(!project_text(malformed[i], kept, 1, 0));
+        assert(!project_text(malformed[i], none, 1, 0));
+        errno = 0;
+        assert(!project_text(malformed[i], all, 1, 0) && errno == EINVAL);
+    }
+    text = project_text(" {\"x\": [[], {}, [{\"y\": [1]}]], \"a\": 3} \n", kept, 1, 0);
+    assert(text && strcmp(text, "{\"a\":3}") == 0);
+    free(text);
+
+    // skipping nests deeper than the bracket stack kept on the C stack
+    char deep[512] = "{\"x\":";
+    size_t length = strlen(deep);
+    memset(deep + length, '[', 200);
+    memset(deep + length + 200, ']', 200);
+    strcpy(deep + length + 400, ",\"a\":3}");
+    text = project_text(deep, kept, 1, 0);
+    assert(text && strcmp(text, "{\"a\":3}") == 0);
+    free(text);
+    deep[length + 399] = '}';
+    assert(!project_text(deep, kept, 1, 0));
+}
+
+void test_utjson_print_escapes(void)
+{
+    utjson *object = utjson_createObject();
+    utjson_setString(object, "say \"hi\"", "line\nbreak\ttab \\ quote\" \x01\x1f\b\f\r / caf\xc3\xa9");
+    char *text = utjson_print(object, false);
+    assert(strcmp(text, "{\"say \\\"hi\\\"\":\"line\\nbreak\\ttab \\\\ quote\\\" \\u0001\\u001f\\b\\f\\r / "
+                        "caf\xc3\xa9\"}") == 0);
+    free(text);
+    utjson_destruct(object);
+
+    // a special byte at every offset of a long string, across the vector widths
+    char value[100];
+    char expected[120];
+    for (size_t at = 0; at < sizeof(value) - 1; at++)
+    {
+        memset(value, 'a', sizeof(value) - 1);
+        value[sizeof(value) - 1] = '\0';
+        value[at] = at % 3 == 0 ? '"' : at % 3 == 1 ? '\\' : '\n';
+        utjson *string = utjson_createString(value);
+        text = utjson_print(string, false);
+        snprintf(expected, sizeof(expected), "\"%.*s\\%c%s\"", (int)at, value, at % 3 == 2 ? 'n' : value[at],
+                 value + at + 1);
+        assert(strcmp(text, expected) == 0);
+        free(text);
+        utjson_destruct(string);
+    }
+
+    // pointer types are escaped like strings and read back unescaped
+    int target = 0;
+    utjson *pointer = utjson_createPointer(&target, "a\"b\\c\n");
+    text = utjson_print(pointer, false);
+    assert(strcmp(text, "\"<:a\\\"b\\\\c\\n:>pointer\"") == 0);
+    utjson *parsed = utjson_parse(text);
+    assert(utjson_IS(POINTER, parsed) && strcmp(parsed->pointer_type, "a\"b\\c\n") == 0);
+    free(text);
+    utjson_destruct(parsed);
+    utjson_destruct(pointer);
+}
+
+void test_utjson_parse_escapes(void)
+{
+    const char *source = "{\"a\\\"b\": \"q\\\"\\\\\\/\\b\\f\\n\\r\\t\", \"u\": \"caf\\u00e9 \\u20AC \\ud83d\\ude00\"}";
+    unsigned engines[] = {utjson_PARSE_RECURSIVE, utjson_PARSE_INDEXED, utjson_PARSE_RECURSIVE | utjson_PARSE_IN_PLACE,
+                          utjson_PARSE_INDEXED | utjson_PARSE_IN_PLACE};
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+    {
+        char *copy = strdup(source);
+        utjson *doc = utjson_parseWith(copy, engines[i]);
+        assert(doc);
+        assert(strcmp(utjson_get(doc, "a\"b")->string, "q\"\\/\b\f\n\r\t") == 0);
+        assert(strcmp(utjson_get(doc, "u")->string, "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80") == 0);
+
+        // printing and parsing again gives the same text
+        char *text = utjson_print(doc, false);
+        utjson *again = utjson_parse(text);
+        char *printed = utjson_print(again, false);
+        assert(strcmp(text, printed) == 0);
+        free(printed);
+        free(text);
+        utjson_destruct(again);
+        utjson_destruct(doc);
+        free(copy);
+    }
+
+    // an escaped quote or backslash at every offset, across the vector widths
+    char value[100];
+    char source_text[110];
+    for (size_t at = 0; at < 90; at++)
+    {
+        memset(value, 'a', sizeof(value));
+        snprintf(source_text, sizeof(source_text), "[\"%.*s\\%c%.*s\"]", (int)at, value, at % 2 ? '"' : '\\',
+                 (int)(90 - at), value);
+        utjson *doc = utjson_parseWith(source_text, utjson_PARSE_INDEXED);
+        assert(doc && strlen(doc->children[0]->string) == 91 && doc->children[0]->string[at] == (at % 2 ? '"' : '\\'));
+        utjson_destruct(doc);
+    }
+
+    // the push parser decodes escapes split across chunks
+    utjson_parser *parser = utjson_parserNew(0);
+    const char *chunks[] = {"{\"k\\", "\"\": \"\\u", "00e9\\", "ud83d\\ude00\"}"};
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+    {
+        assert(utjson_parserFeed(parser, chunks[i], strlen(chunks[i])));
+    }
+    utjson *doc = utjson_parserFinish(parser);
+    assert(doc && strcmp(utjson_get(doc, "k\"")->string, "\xc3\xa9\xf0\x9f\x98\x80") == 0);
+    utjson_destruct(doc);
+
+    // malformed escapes and lone surrogates are rejected
+    const char *invalid[] = {"[\"\\x\"]", "[\"\\u12\"]", "[\"\\u12G4\"]", "[\"\\ud83d\"]", "[\"\\ud83dx\"]",
+                             "[\"\\ude00\"]", "{\"\\q\": 1}", "[\"abc\\\"]"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        for (size_t e = 0; e < 2; e++)
+        {
+            char *copy = strdup(invalid[i]);
+            assert(!utjson_parseWith(copy, engines[e]));
+            free(copy);
+        }
+    }
+}
+
+void test_utjson_parse_utf8(void)
+{
+    unsigned engines[] = {utjson_PARSE_RECURSIVE, utjson_PARSE_INDEXED, utjson_PARSE_RECURSIVE | utjson_PARSE_IN_PLACE};
+    const char *valid[] = {"[\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 \xf4\x8f\xbf\xbf\"]", "{\"\xed\x9f\xbf\": \"\xee\x80\x80\"}",
+                           "[\"\\ud83d\\ude00\"]"};
+    const char *invalid[] = {
+        "[\"\x80\"]",                 // stray continuation
+        "[\"\xc3\"]",                 // truncated
+        "[\"\xe2\x82\"]",             // truncated
+        "[\"\xc0\xaf\"]",             // overlong
+        "[\"\xe0\x80\xaf\"]",         // overlong
+        "[\"\xf0\x80\x80\xaf\"]",     // overlong
+        "[\"\xed\xa0\x80\"]",         // surrogate
+        "[\"\xf4\x90\x80\x80\"]",     // past U+10FFFF
+        "[\"\xff\"]",                 // never valid
+        "{\"k\xe9y\": 1}",            // latin-1 key
+    };
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++)
+    {
+        for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++)
+        {
+            char *copy = strdup(valid[i]);
+            utjson *doc = utjson_parseWith(copy, engines[e] | utjson_PARSE_VALIDATE_UTF8);
+            assert(doc);
+            utjson_destruct(doc);
+            free(copy);
+        }
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+        {
+            char *copy = strdup(invalid[i]);
+            errno = 0;
+            assert(!utjson_parseWith(copy, engines[e] | utjson_PARSE_VALIDATE_UTF8));
+            assert(errno == EILSEQ);
+            free(copy);
+
+            // without the flag the bytes are kept as they are
+            copy = strdup(invalid[i]);
+            utjson *doc = utjson_parseWith(copy, engines[e]);
+            assert(doc);
+            utjson_destruct(doc);
+            free(copy);
+        }
+    }
+
+    // a bad sequence at every offset of a long string, across the vector widths and the tail
+    char source[160];
+    for (size_t at = 0; at < 140; at++)
+    {
+        memset(source, 'a', sizeof(source));
+        memcpy(source, "[\"", 2);
+        memcpy(source + 2 + at, at % 2 ? "\xe2\x82\xac" : "\xe2\x82", at % 2 ? 3 : 2);
+        memcpy(source + sizeof(source) - 3, "\"]", 3);
+        utjson *doc = utjson_parseWith(source, utjson_PARSE_INDEXED | utjson_PARSE_VALIDATE_UTF8);
+        assert(at % 2 ? doc != NULL : doc == NULL);
+        utjson_destruct(doc);
+    }
+
+    // the push parser validates strings split across chunks
+    utjson_parser *parser = utjson_parserNew(utjson_PARSE_VALIDATE_UTF8);
+    assert(utjson_parserFeed(parser, "[\"\xe2", 3));
+    assert(utjson_parserFeed(parser, "\x82\xac\", \"\xe2\x82", 7));
+    assert(!utjson_parserFeed(parser, "\"]", 2));
+    assert(utjson_parserFinish(parser) == NULL);
+}
+
+void test_utjson_binary(void)
+{
+    char path[] = "/tmp/utjson_test_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    // the large object gets a member index in the image, the small one is scanned
+    char json[2048] = "{\"name\": \"snapshot\", \"id\": 18446744073709551615, \"ok\": true, \"pi\": 3.25, "
+                      "\"none\": null, \"list\": [1, \"two\", [], {}], \"wide\": {";
+    for (int i = 0; i < 40; i++)
+    {
+        snprintf(json + strlen(json), sizeof(json) - strlen(json), "%s\"k%d\": %d", i ? ", " : "", i, i * i);
+    }
+    strcat(json, "}}");
+    utjson *parsed = utjson_parseWith(json, utjson_PARSE_INTEGERS);
+    char *expected = utjson_print(parsed, false);
+    assert(utjson_saveBinary(parsed, path));
+    utjson_destruct(parsed);
+
+    for (int round = 0; round < 2; round++)
+    {
+        utjson *mapped = utjson_mapBinary(path);
+        assert(mapped && (mapped->flags & utjson_MAPPED));
+        // a second mapping of the same image while the first one holds its preferred address is relocated
+        utjson *again = round ? utjson_mapBinary(path) : NULL;
+        utjson *doc = round ? again : mapped;
+        assert(doc && doc != (round ? mapped : NULL));
+
+        assert(strcmp(utjson_asString(utjson_get(doc, "name")), "snapshot") == 0);
+        assert(utjson_asUint64(utjson_get(doc, "id")) == UINT64_MAX);
+        assert(strcmp(utjson_asString(utjson_get(doc, "id")), "18446744073709551615") == 0);
+        assert(utjson_asNumber(utjson_get(doc, "pi")) == 3.25 && utjson_asBool(utjson_get(doc, "ok")));
+        assert(utjson_IS(NULL, utjson_get(doc, "none")));
+        utjson *list = utjson_get(doc, "list");
+        assert(list->used == 4 && strcmp(utjson_asString(utjson_select(list, 1)), "two") == 0);
+        assert(utjson_select(list, 0)->parent == list);
+        utjson *wide = utjson_get(doc, "wide");
+        assert(wide->members && utjson_asNumber(utjson_get(wide, "k39")) == 39 * 39 && !utjson_get(wide, "k40"));
+        utjson_key key = utjson_keyCompile("k7");
+        assert(utjson_asNumber(utjson_getByKey(wide, &key)) == 49);
+
+        char *text = utjson_print(doc, false);
+        assert(strcmp(text, expected) == 0);
+        free(text);
+
+        // a mutable copy
+        utjson *copy = utjson_clone(doc);
+        assert(utjson_set(copy, "name", utjson_createString("copy")));
+        utjson_destruct(copy);
+
+        utjson_destruct(list); // not the root: nothing happens
+        utjson_destruct(again);
+        utjson_destruct(mapped);
+    }
+    free(expected);
+
+    // not an image
+    fd = open(path, O_WRONLY | O_TRUNC);
+    assert(fd >= 0 && write(fd, "{\"a\": 1}", 8) == 8);
+    close(fd);
+    errno = 0;
+    assert(!utjson_mapBinary(path) && errno == EINVAL);
+    unlink(path);
+    assert(!utjson_mapBinary(path) && errno == ENOENT);
+}
+
+static void check_cbor(utjson *value, const char *hex)
+{
+    size_t length;
+    uint8_t *encoded = utjson_toCBOR(value, &length);
+    char text[64] = "";
+    for (size_t i = 0; i < length && i < 31; i++)
+    {
+        snprintf(text + 2 * i, 3, "%02x", encoded[i]);
+    }
+    assert(strcmp(text, hex) == 0);
+    free(encoded);
+    utjson_destruct(value);
+}
+
+void test_utjson_cbor(void)
+{
+    // examples of RFC 8949 appendix A
+    check_cbor(utjson_createInt64(0), "00");
+    check_cbor(utjson_createInt64(23), "17");
+    check_cbor(utjson_createInt64(24), "1818");
+    check_cbor(utjson_createInt64(1000), "1903e8");
+    check_cbor(utjson_createUint64(UINT64_MAX), "1bffffffffffffffff");
+    check_cbor(utjson_createInt64(-1000), "3903e7");
+    check_cbor(utjson_createInt64(INT64_MIN), "3b7fffffffffffffff");
+    check_cbor(utjson_createNumber(0.0), "f90000");
+    check_cbor(utjson_createNumber(-0.0), "f98000");
+    check_cbor(utjson_createNumber(1.5), "f93e00");
+    check_cbor(utjson_createNumber(65504.0), "f97bff");
+    check_cbor(utjson_createNumber(5.960464477539063e-8), "f90001");
+    check_cbor(utjson_createNumber(100000.0), "fa47c35000");
+    check_cbor(utjson_createNumber(1.1), "fb3ff199999999999a");
+    check_cbor(utjson_createBool(true), "f5");
+    check_cbor(utjson_createNull(), "f6");
+    check_cbor(utjson_createString("IETF"), "6449455446");
+    check_cbor(utjson_createString("a\xff"), "4261ff"); // not UTF-8: a byte string
+
+    // trees the default parser builds from bytes that are not UTF-8 still encode to valid CBOR
+    utjson *loose = utjson_parse("{\"k\xff\": \"v\xfe\"}");
+    size_t loose_length;
+    uint8_t *loose_cbor = utjson_toCBOR(loose, &loose_length);
+    utjson *loose_back = utjson_fromCBOR(loose_cbor, loose_length);
+    char *loose_text = utjson_print(loose_back, false);
+    assert(strcmp(loose_text, "{\"a_8\":\"dv4\"}") == 0);
+    free(loose_text);
+    free(loose_cbor);
+    utjson_destruct(loose_back);
+    utjson_destruct(loose);
+    check_cbor(utjson_parseWith("[1, [2, 3]]", utjson_PARSE_INTEGERS), "8201820203");
+    check_cbor(utjson_parseWith("{\"a\": 1, \"b\": [2, 3]}", utjson_PARSE_INTEGERS), "a26161016162820203");
+    check_cbor(utjson_parse("[1, 2.5]"), "82f93c00f94100"); // plain numbers are doubles
+
+    // a tree survives the round trip, member order and integer storage included
+    char *json = "{\"name\": \"cbor \\u00e9\", \"id\": 18446744073709551615, \"neg\": -42, \"pi\": 3.141592653589793, "
+                 "\"half\": 0.5, \"ok\": false, \"none\": null, \"list\": [[], {}, [1, [2, [3]]]], \"z\": \"\"}";
+    utjson *parsed = utjson_parseWith(json, utjson_PARSE_INTEGERS);
+    size_t length;
+    uint8_t *encoded = utjson_toCBOR(parsed, &length);
+    assert(encoded);
+    utjson *decoded = utjson_fromCBOR(encoded, length);
+    assert(decoded && (utjson_get(decoded, "id")->flags & utjson_UNSIGNED));
+    char *expected = utjson_print(parsed, false);
+    char *text = utjson_print(decoded, false);
+    assert(strcmp(text, expected) == 0);
+    free(text);
+    utjson_destruct(decoded);
+
+    utjson_arena *arena = utjson_arenaCreate(0);
+    decoded = utjson_fromCBORIn(arena, encoded, length);
+    text = utjson_print(decoded, false);
+    assert(strcmp(text, expected) == 0);
+    free(text);
+    arena = utjson_arenaDestroy(arena);
+    free(expected);
+    utjson_destruct(parsed);
+
+    // every truncation is rejected, as is a trailing byte
+    for (size_t cut = 0; cut < length; cut++)
+    {
+        errno = 0;
+        assert(!utjson_fromCBOR(encoded, cut) && errno == EINVAL);
+    }
+    uint8_t *longer = malloc(length + 1);
+    memcpy(longer, encoded, length);
+    longer[length] = 0;
+    assert(!utjson_fromCBOR(longer, length + 1));
+    free(longer);
+    free(encoded);
+
+    // indefinite lengths, chunked strings and tags from other encoders
+    const uint8_t indefinite[] = {0xbf, 0x63, 'F', 'u', 'n', 0xf5, 0x7f, 0x61, 'A', 0x62, 'm', 't', 0xff, 0x9f, 0xc1,
+                                  0x1a, 0x51, 0x4b, 0x67, 0xb0, 0xf9, 0x3c, 0x00, 0xf7, 0xff, 0xff};
+    decoded = utjson_fromCBOR(indefinite, sizeof(indefinite));
+    text = utjson_print(decoded, false);
+    assert(strcmp(text, "{\"Fun\":true,\"Amt\":[1363896240,1,null]}") == 0);
+    free(text);
+    utjson_destruct(decoded);
+
+    // nesting costs no C stack
+    size_t depth = 200000;
+    uint8_t *deep = malloc(depth + 1);
+    memset(deep, 0x81, depth);
+    deep[depth] = 0xf6;
+    decoded = utjson_fromCBOR(deep, depth + 1);
+    assert(decoded && decoded->used == 1);
+    free(deep);
+    // destruct is recursive: unwind from the innermost level
+    utjson *inner = decoded;
+    while (inner->used)
+        inner = inner->children[0];
+    while (inner != decoded)
+    {
+        utjson *outer = inner->parent;
+        utjson_destruct(utjson_detach(inner));
+        inner = outer;
+    }
+    utjson_destruct(decoded);
+
+    // byte strings, as values, keys or in chunks, become base64url text without padding
+    const uint8_t bytes[] = {0x87, 0x40, 0x41, 'f', 0x43, 'f', 'o', 'o', 0x46, 'f', 'o', 'o', 'b', 'a', 'r',
+                             0x43, 0xfb, 0xff, 0x00, 0x5f, 0x42, 'f', 'o', 0x42, 'o', 'b', 0xff, 0xa1, 0x42, 0x00, 0x01,
+                             0x01};
+    decoded = utjson_fromCBOR(bytes, sizeof(bytes));
+    text = utjson_print(decoded, false);
+    assert(strcmp(text, "[\"\",\"Zg\",\"Zm9v\",\"Zm9vYmFy\",\"-_8A\",\"Zm9vYg\",{\"AAE\":1}]") == 0);
+    free(text);
+    utjson_destruct(decoded);
+
+    // nested arrays that each announce as many elements as bytes remain reserve little up front
+    size_t levels = 20000;
+    uint8_t *claims = malloc(levels * 5);
+    for (size_t i = 0; i < levels; i++)
+    {
+        uint32_t remaining = (uint32_t)((levels - i - 1) * 5);
+        uint8_t head[] = {0x9a, (uint8_t)(remaining >> 24), (uint8_t)(remaining >> 16), (uint8_t)(remaining >> 8),
+                          (uint8_t)remaining};
+        memcpy(claims + i * 5, head, 5);
+    }
+    errno = 0;
+    assert(!utjson_fromCBOR(claims, levels * 5) && errno == EINVAL);
+    free(claims);
+
+    // counts larger than the input, reserved values, a break out of place, non-string keys,
+    // text with a NUL byte or that is not UTF-8
+    const uint8_t *malformed[] = {(const uint8_t *)"\x9b\xff\xff\xff\xff\xff\xff\xff\xff", (const uint8_t *)"\x1c",
+                                  (const uint8_t *)"\xff", (const uint8_t *)"\xa1\x01\x02", (const uint8_t *)"\xf0",
+                                  (const uint8_t *)"\x62\x61\x00", (const uint8_t *)"\x62\xc3\x28",
+                                  (const uint8_t *)"\xa1\x61\xff\x01"};
+    size_t lengths[] = {9, 1, 1, 3, 1, 3, 3, 4};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+    {
+        errno = 0;
+        assert(!utjson_fromCBOR(malformed[i], lengths[i]) && errno == EINVAL);
+    }
+}
+
 int main(void)
 {
     // Run the tests
@@ -165,6 +1531,31 @@ int main(void)
     test_utjson_set();
     test_utjson_add();
     test_utjson_parse_print();
+    test_utjson_printTo();
+    test_utjson_arena();
+    test_utjson_large_array();
+    test_utjson_parse_indexed();
+    test_utjson_parseInPlace();
+    test_utjson_compact_object();
+    test_utjson_parser();
+    test_utjson_parseEvents();
+    test_utjson_parseLines();
+    test_utjson_parseFile();
+    test_utjson_parse_numbers();
+    test_utjson_print_numbers();
+    test_utjson_int64();
+    test_utjson_intern();
+    test_utjson_key();
+    test_utjson_small_object();
+    test_utjson_member_order();
+    test_utjson_pointer();
+    test_utjson_path();
+    test_utjson_parseProjected();
+    test_utjson_print_escapes();
+    test_utjson_parse_escapes();
+    test_utjson_parse_utf8();
+    test_utjson_binary();
+    test_utjson_cbor();
 
     printf("All tests passed!\n");
     return 0;
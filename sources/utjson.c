@@ -1,9 +1,156 @@
+// object tables of arena-backed nodes are placed into the arena too
+#define uthash_malloc(sz) hash_alloc(sz)
+#define uthash_free(ptr, sz) hash_free(ptr)
+// interned names are compared by address first
+#define HASH_KEYCMP(a, b, n) ((a) == (b) ? 0 : memcmp(a, b, n))
+
 #include "utjson.h"
+#include "utjson_internal.h"
+#include "utjson_simd.h"
 #include <ctype.h>
 #include <errno.h>
 #include <sys/time.h>
 #include <syslog.h>
 
+static __thread utjson_arena *hash_arena = NULL;
+
+static void *hash_alloc(size_t size)
+{
+    return hash_arena ? utjson_arenaAlloc(hash_arena, size) : malloc(size);
+}
+
+static void hash_free(void *ptr)
+{
+    if (!hash_arena)
+    {
+        free(ptr);
+    }
+}
+
+// runs a uthash statement against the table of node, allocating where node lives
+#define WITH_HASH_ARENA(node, statement) \
+    do                                   \
+    {                                    \
+        hash_arena = (node)->arena;      \
+        statement;                       \
+        hash_arena = NULL;               \
+    } while (0)
+
+#define node_arena(node) ((node) ? (node)->arena : NULL)
+
+static utjson *node_new(utjson_arena *arena, utjson_type type)
+{
+    utjson *object = NULL;
+    if (arena)
+    {
+        object = utjson_arenaAlloc(arena, sizeof(utjson));
+        if (object)
+        {
+            memset(object, 0, sizeof(utjson));
+            object->arena = arena;
+        }
+    }
+    else
+    {
+        object = utjson_construct();
+    }
+    if (!object)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    object->type = type;
+    return object;
+}
+
+static char *node_strdup(utjson_arena *arena, const char *source)
+{
+    return arena ? utjson_arenaStrndup(arena, source, strlen(source)) : strdup(source);
+}
+
+static void node_release_name(utjson *object)
+{
+    if (object->name && !object->arena && !(object->flags & utjson_BORROWED_NAME))
+    {
+        free(object->name);
+    }
+    object->name = NULL;
+    object->flags &= ~(utjson_BORROWED_NAME | utjson_INTERNED_NAME);
+}
+
+// length and uthash hash of a member name; interned names carry both
+static unsigned name_hash(const char *name, uint8_t name_flags, size_t *length)
+{
+    if (name_flags & utjson_INTERNED_NAME)
+    {
+        *length = utjson_internLength(name);
+        return utjson_internHash(name);
+    }
+    unsigned hashv;
+    *length = strlen(name);
+    HASH_VALUE(name, *length, hashv);
+    return hashv;
+}
+
+// numeric value of a BOOL or NUMBER node, whatever its storage
+static double node_number(const utjson *object)
+{
+    if (!(object->flags & utjson_INTEGER))
+        return object->number;
+    return object->flags & utjson_UNSIGNED ? (double)object->uinteger : (double)object->integer;
+}
+
+// text of a BOOL or NUMBER node, integers go through the integer path
+static size_t node_format(const utjson *object, char *text)
+{
+    if (!(object->flags & utjson_INTEGER))
+        return utjson_numberFormat(object->number, text);
+    if (object->flags & utjson_UNSIGNED)
+        return utjson_integerFormat(object->uinteger, false, text);
+    return utjson_integerFormat(object->integer < 0 ? 0 - (uint64_t)object->integer : (uint64_t)object->integer,
+                                object->integer < 0, text);
+}
+
+static void *node_calloc(utjson_arena *arena, size_t size)
+{
+    if (!arena)
+        return calloc(1, size);
+    void *memory = utjson_arenaAlloc(arena, size);
+    if (memory)
+    {
+        memset(memory, 0, size);
+    }
+    return memory;
+}
+
+static void *node_realloc(utjson_arena *arena, void *ptr, size_t used, size_t size)
+{
+    if (!arena)
+        return realloc(ptr, size);
+    // arena memory is never given back, the old copy stays until the reset
+    void *memory = utjson_arenaAlloc(arena, size);
+    if (memory && ptr)
+    {
+        memcpy(memory, ptr, used);
+    }
+    return memory;
+}
+
+// releases the member index of an object, the members stay
+static void members_drop(utjson *target)
+{
+    utjson_member *member = NULL;
+    utjson_member *tmp = NULL;
+    HASH_ITER(hh, target->members, member, tmp)
+    {
+        WITH_HASH_ARENA(target, HASH_DEL(target->members, member));
+        if (!target->arena)
+        {
+            free(member);
+        }
+    }
+}
+
 /**
  * Current version
  *
@@ -22,8 +169,27 @@ char *utjson_version(void)
  */
 utjson *utjson_destruct(utjson *object)
 {
+    if (!object)
+        return NULL;
+    if (object->flags & utjson_MAPPED)
+    {
+        // the nodes of an image go with its mapping, which the root holds
+        if (!object->parent)
+        {
+            utjson_binaryUnmap(object);
+        }
+        return NULL;
+    }
+
     switch (object->type)
     {
+    case utjson_OBJECT:
+        // the member index goes first, the members are children like array elements
+        if (!object->arena)
+        {
+            members_drop(object);
+        }
+        // fall through
     case utjson_ARRAY:
         // destuct all elements of array
         for (size_t idx = 0; idx < object->used; idx++)
@@ -33,36 +199,50 @@ utjson *utjson_destruct(utjson *object)
                 object->children[idx] = utjson_destruct(object->children[idx]);
             }
         }
+        if (object->arena)
+            return NULL; // the memory belongs to the arena
+        FREE_AND_NULL(object->children);
         break;
-    case utjson_OBJECT:
-        // destuct all children of object
+    case utjson_BOOL:
+        // fall through
+    case utjson_NUMBER:
+        // fall through
+    case utjson_STRING:
+        if (object->arena)
+            return NULL;
+        if (object->flags & utjson_BORROWED_STRING)
         {
-            utjson *current = NULL;
-            utjson *tmp = NULL;
-            HASH_ITER(hh, *(object->children), current, tmp)
-            {
-                HASH_DEL(*(object->children), current);
-                {
-                    if (current)
-                    {
-                        utjson_destruct(current);
-                    }
-                }
-            }
+            object->string = NULL;
         }
+        FREE_AND_NULL(object->string);
+        break;
+    case utjson_POINTER:
+        if (object->arena)
+            return NULL;
+        FREE_AND_NULL(object->pointer_type);
         break;
     default:
+        if (object->arena)
+            return NULL;
         break;
     }
-    FREE_AND_NULL(object->string);
-    FREE_AND_NULL(object->name);
-    FREE_AND_NULL(object->pointer_type);
-    FREE_AND_NULL(object->children);
+    node_release_name(object);
     FREE_AND_NULL(object);
 
     return NULL;
 }
 
+/**
+ * Creates Null in the arena
+ *
+ * @param arena
+ * @return utjson*
+ */
+utjson *utjson_createNullIn(utjson_arena *arena)
+{
+    return node_new(arena, utjson_NULL);
+}
+
 /**
  * Creates Null
  *
@@ -70,7 +250,24 @@ utjson *utjson_destruct(utjson *object)
  */
 utjson *utjson_createNull(void)
 {
-    return utjson_construct();
+    return utjson_createNullIn(NULL);
+}
+
+/**
+ * Creates boolean in the arena
+ *
+ * @param arena
+ * @param value
+ * @return utjson*
+ */
+utjson *utjson_createBoolIn(utjson_arena *arena, bool value)
+{
+    utjson *object = node_new(arena, utjson_BOOL);
+    if (object)
+    {
+        object->number = (double)value;
+    }
+    return object;
 }
 
 /**
@@ -81,11 +278,22 @@ utjson *utjson_createNull(void)
  */
 utjson *utjson_createBool(bool value)
 {
-    utjson *object = utjson_construct();
+    return utjson_createBoolIn(NULL, value);
+}
+
+/**
+ * Creates number in the arena
+ *
+ * @param arena
+ * @param value
+ * @return utjson*
+ */
+utjson *utjson_createNumberIn(utjson_arena *arena, double value)
+{
+    utjson *object = node_new(arena, utjson_NUMBER);
     if (object)
     {
-        object->type = utjson_BOOL;
-        object->number = (double)value;
+        object->number = value;
     }
     return object;
 }
@@ -98,61 +306,156 @@ utjson *utjson_createBool(bool value)
  */
 utjson *utjson_createNumber(double value)
 {
-    utjson *object = utjson_construct();
+    return utjson_createNumberIn(NULL, value);
+}
+
+/**
+ * Creates integer in the arena
+ *
+ * @param arena
+ * @param value
+ * @return utjson*
+ */
+utjson *utjson_createInt64In(utjson_arena *arena, int64_t value)
+{
+    utjson *object = node_new(arena, utjson_NUMBER);
     if (object)
     {
-        object->type = utjson_NUMBER;
-        object->number = value;
+        object->integer = value;
+        object->flags |= utjson_INTEGER;
     }
     return object;
 }
 
 /**
- * Creates string
+ * Creates integer
  *
  * @param value
  * @return utjson*
  */
-utjson *utjson_createString(char *value)
+utjson *utjson_createInt64(int64_t value)
+{
+    return utjson_createInt64In(NULL, value);
+}
+
+/**
+ * Creates unsigned integer in the arena
+ *
+ * @param arena
+ * @param value
+ * @return utjson*
+ */
+utjson *utjson_createUint64In(utjson_arena *arena, uint64_t value)
 {
-    utjson *object = utjson_construct();
+    if (value <= INT64_MAX)
+        return utjson_createInt64In(arena, (int64_t)value);
+    utjson *object = node_new(arena, utjson_NUMBER);
     if (object)
     {
-        object->type = utjson_STRING;
-        object->string = value ? strdup(value) : NULL;
+        object->uinteger = value;
+        object->flags |= utjson_INTEGER | utjson_UNSIGNED;
     }
     return object;
 }
 
 /**
- * Creates array
+ * Creates unsigned integer
  *
  * @param value
  * @return utjson*
  */
-utjson *utjson_createArray(void)
+utjson *utjson_createUint64(uint64_t value)
+{
+    return utjson_createUint64In(NULL, value);
+}
+
+/**
+ * Creates string in the arena
+ *
+ * @param arena
+ * @param value
+ * @return utjson*
+ */
+utjson *utjson_createStringIn(utjson_arena *arena, char *value)
 {
-    utjson *object = utjson_construct();
+    utjson *object = node_new(arena, utjson_STRING);
     if (object)
     {
-        object->type = utjson_ARRAY;
+        object->string = value ? node_strdup(arena, value) : NULL;
     }
     return object;
 }
 
 /**
- * Creates object
+ * Creates string
  *
  * @param value
  * @return utjson*
  */
+utjson *utjson_createString(char *value)
+{
+    return utjson_createStringIn(NULL, value);
+}
+
+/**
+ * Creates array in the arena
+ *
+ * @param arena
+ * @return utjson*
+ */
+utjson *utjson_createArrayIn(utjson_arena *arena)
+{
+    return node_new(arena, utjson_ARRAY);
+}
+
+/**
+ * Creates array
+ *
+ * @return utjson*
+ */
+utjson *utjson_createArray(void)
+{
+    return utjson_createArrayIn(NULL);
+}
+
+/**
+ * Creates object in the arena
+ *
+ * @param arena
+ * @return utjson*
+ */
+utjson *utjson_createObjectIn(utjson_arena *arena)
+{
+    return node_new(arena, utjson_OBJECT);
+}
+
+/**
+ * Creates object
+ *
+ * @return utjson*
+ */
 utjson *utjson_createObject(void)
 {
-    utjson *object = utjson_construct();
+    return utjson_createObjectIn(NULL);
+}
+
+/**
+ * Creates a JSON object representing a pointer in the arena.
+ *
+ * @param arena The arena to allocate from (NULL for the heap).
+ * @param ptr The pointer to store.
+ * @param type A string describing the pointer type.
+ * @return A utjson object of type utjson_POINTER.
+ */
+utjson *utjson_createPointerIn(utjson_arena *arena, void *ptr, const char *type)
+{
+    if (!type)
+        return NULL;
+    utjson *object = node_new(arena, utjson_POINTER);
     if (object)
     {
-        object->type = utjson_OBJECT;
-        object->children = calloc(1, sizeof(utjson *));
+        object->pointer = ptr;
+        object->pointer_type = node_strdup(arena, type);
     }
     return object;
 }
@@ -166,13 +469,7 @@ utjson *utjson_createObject(void)
  */
 utjson *utjson_createPointer(void *ptr, const char *type)
 {
-    if (!type)
-        return NULL;
-    utjson *object = utjson_construct();
-    object->type = utjson_POINTER;
-    object->pointer = ptr;
-    object->pointer_type = strdup(type);
-    return object;
+    return utjson_createPointerIn(NULL, ptr, type);
 }
 
 /**
@@ -194,13 +491,13 @@ bool utjson_asBool(utjson *object)
         case utjson_BOOL:
             // fall through
         case utjson_NUMBER:
-            return (bool)object->number;
+            return node_number(object) != 0;
         case utjson_STRING:
             return object->string && object->string[0] ? true : false;
         case utjson_ARRAY:
             return (bool)object->used;
         case utjson_OBJECT:
-            return object->children ? (bool)HASH_COUNT(object->children[0]) : false;
+            return (bool)object->used;
         }
     }
     errno = EINVAL;
@@ -226,19 +523,74 @@ double utjson_asNumber(utjson *object)
         case utjson_BOOL:
             // fall through
         case utjson_NUMBER:
-            return object->number;
+            return node_number(object);
         case utjson_STRING:
             return object->string && object->string[0] ? atof(object->string) : 0;
         case utjson_ARRAY:
             return (double)object->used;
         case utjson_OBJECT:
-            return object->children ? (double)HASH_COUNT(object->children[0]) : 0;
+            return (double)object->used;
         }
     }
     errno = EINVAL;
     return 0;
 }
 
+/**
+ * Converts value to integer
+ *
+ * @param object
+ * @return int64_t
+ */
+int64_t utjson_asInt64(utjson *object)
+{
+    if (utjson_IS(NUMBER, object) && (object->flags & utjson_INTEGER))
+    {
+        if (!(object->flags & utjson_UNSIGNED))
+            return object->integer;
+        errno = ERANGE;
+        return INT64_MAX;
+    }
+    if (utjson_IS(STRING, object))
+        return object->string ? strtoll(object->string, NULL, 10) : 0;
+
+    double value = utjson_asNumber(object);
+    // 2^63 is the first double past INT64_MAX
+    if (value >= 9223372036854775808.0 || value < -9223372036854775808.0 || value != value)
+    {
+        errno = ERANGE;
+        return value < 0 ? INT64_MIN : value > 0 ? INT64_MAX : 0;
+    }
+    return (int64_t)value;
+}
+
+/**
+ * Converts value to unsigned integer
+ *
+ * @param object
+ * @return uint64_t
+ */
+uint64_t utjson_asUint64(utjson *object)
+{
+    if (utjson_IS(NUMBER, object) && (object->flags & utjson_INTEGER))
+    {
+        if ((object->flags & utjson_UNSIGNED) || object->integer >= 0)
+            return object->uinteger; // the same bits either way
+        errno = ERANGE;
+        return 0;
+    }
+    if (utjson_IS(STRING, object) && object->string && object->string[0] != '-')
+        return strtoull(object->string, NULL, 10);
+
+    double value = utjson_asNumber(object);
+    if (value >= 18446744073709551616.0 || value <= -1 || value != value)
+    {
+        errno = ERANGE;
+        return value > 0 ? UINT64_MAX : 0;
+    }
+    return (uint64_t)value;
+}
+
 /**
  * Converts value to string
  *
@@ -258,8 +610,19 @@ char *utjson_asString(utjson *object)
         case utjson_BOOL:
             // fall through
         case utjson_NUMBER:
-            FREE_AND_NULL(object->string);
-            asprintf(&(object->string), "%f", object->number);
+        {
+            if (object->flags & utjson_MAPPED)
+                return object->string; // written with the image
+            char text[utjson_NUMBER_TEXT];
+            node_format(object, text);
+            if (!object->arena)
+            {
+                FREE_AND_NULL(object->string);
+            }
+            object->string = node_strdup(object->arena, text);
+            if (!object->string)
+                return NULL;
+        }
             // fall through
         case utjson_STRING:
             return object->string;
@@ -286,39 +649,198 @@ void *utjson_asPointer(utjson *object, char **pointer_type)
 {
     if (pointer_type)
     {
-        *pointer_type = pointer_type && object ? object->pointer_type : NULL;
+        *pointer_type = utjson_IS(POINTER, object) ? object->pointer_type : NULL;
     }
     return utjson_IS(POINTER, object) ? object->pointer : NULL;
 }
 
+static bool children_reserve(utjson *container, size_t capacity)
+{
+    if (capacity <= container->allocated)
+        return true;
+    if (capacity > SIZE_MAX / sizeof(utjson *))
+    {
+        errno = ENOMEM;
+        return false;
+    }
+    utjson **children = node_realloc(container->arena, container->children,
+                                     container->used * sizeof(utjson *), capacity * sizeof(utjson *));
+    if (!children)
+    {
+        errno = ENOMEM;
+        return false;
+    }
+    container->children = children;
+    container->allocated = capacity;
+    return true;
+}
+
+static bool children_append(utjson *container, utjson *object)
+{
+    if (container->allocated <= container->used &&
+        !children_reserve(container, container->allocated ? container->allocated * 2 : utjson_ARRAY_INCREMENT))
+        return false;
+    container->children[container->used++] = object;
+    object->parent = container;
+    return true;
+}
+
+static bool member_index(utjson *target, utjson *object, size_t position, const utjson_key *key)
+{
+    utjson_member *member = node_calloc(target->arena, sizeof(utjson_member));
+    if (!member)
+        return false;
+    size_t length = key ? key->length : 0;
+    unsigned hashv = key ? key->hash : name_hash(object->name, object->flags, &length);
+    member->position = position;
+    WITH_HASH_ARENA(target, HASH_ADD_KEYPTR_BYHASHVALUE(hh, target->members, object->name, length, hashv, member));
+    return true;
+}
+
 /**
- * Sets the named child object
+ * Position of the member called name, target->used if there is none
  *
- * @param target
- * @param name
- * @param object
- * @return utjson *
+ * Small objects have no index and are scanned; the hash (from key, if given)
+ * is computed only for indexed ones.
  */
-utjson *utjson_set(utjson *target, char *name, utjson *object)
+static size_t member_find(const utjson *target, const char *name, uint8_t name_flags, const utjson_key *key,
+                          utjson_member **found)
 {
-    if (utjson_IS(OBJECT, target) && name)
+    if (!target->members)
     {
-        // bool created = false;
-        if (!object)
+        for (size_t i = 0; i < target->used; i++)
         {
-            object = utjson_createNull();
-            // created = true;
+            // one pool gives equal names one address, but names from different pools only compare equal
+            const utjson *child = target->children[i];
+            if (child->name == name || strcmp(child->name, name) == 0)
+                return i;
         }
-        if (object)
+        return target->used;
+    }
+    size_t length = key ? key->length : 0;
+    unsigned hashv = key ? key->hash : name_hash(name, name_flags, &length);
+    utjson_member *member = NULL;
+    HASH_FIND_BYHASHVALUE(hh, target->members, name, length, hashv, member);
+    if (found)
+    {
+        *found = member;
+    }
+    return member ? member->position : target->used;
+}
+
+static bool member_insert(utjson *target, utjson *object, const utjson_key *key)
+{
+    if (!children_append(target, object))
+        return false;
+    if (target->members)
+    {
+        if (member_index(target, object, target->used - 1, key))
+            return true;
+        target->used--;
+        return false;
+    }
+    if (target->used > utjson_OBJECT_INDEX_THRESHOLD)
+    {
+        // past the threshold a scan costs more than hashing: index every member
+        for (size_t i = 0; i < target->used; i++)
+        {
+            if (!member_index(target, target->children[i], i, i + 1 == target->used ? key : NULL))
+            {
+                // stays a correct small object, scanned instead
+                members_drop(target);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+static void member_remove(utjson *target, utjson *object)
+{
+    size_t position = 0;
+    while (position < target->used && target->children[position] != object)
+        position++;
+    if (position == target->used)
+        return;
+
+    if (target->members)
+    {
+        utjson_member *member = NULL;
+        member_find(target, object->name, object->flags, NULL, &member);
+        if (member)
+        {
+            WITH_HASH_ARENA(target, HASH_DEL(target->members, member));
+            if (!target->arena)
+            {
+                free(member);
+            }
+        }
+        // the members behind it move up one slot, keeping insertion order
+        utjson_member *tmp = NULL;
+        if (position + 1 < target->used)
+        {
+            HASH_ITER(hh, target->members, member, tmp)
+            {
+                if (member->position > position)
+                {
+                    member->position--;
+                }
+            }
+        }
+    }
+    memmove(&target->children[position], &target->children[position + 1],
+            (target->used - position - 1) * sizeof(utjson *));
+    target->used--;
+}
+
+// stores object under name; a compiled key supplies the length and hash of name
+static utjson *object_store(utjson *target, char *name, utjson *object, uint8_t name_flags, const utjson_key *key)
+{
+    if (utjson_IS(OBJECT, target) && name)
+    {
+        if (!object)
+        {
+            object = utjson_createNullIn(target->arena);
+        }
+        if (object)
         {
-            object->name = strdup(name);
-            utjson *replaced = NULL;
-            HASH_REPLACE_STR(*(target->children), name, object, replaced);
-            if (replaced)
+            // looked up before the node gives up its name, which may be the one asked for
+            utjson_member *member = NULL;
+            size_t position = member_find(target, name, name_flags, key, &member);
+            if (position < target->used && target->children[position] == object)
+                return object; // already stored under this name
+            if (object->parent == target)
             {
+                // moved to another name: the old slot goes while its name still finds it
+                member_remove(target, object);
+                position = member_find(target, name, name_flags, key, &member);
+            }
+
+            char *stored = (name_flags & utjson_BORROWED_NAME) ? name : node_strdup(object->arena, name);
+            if (!stored)
+            {
+                errno = ENOMEM;
+                return NULL;
+            }
+            node_release_name(object);
+            object->name = stored;
+            object->flags |= name_flags & (utjson_BORROWED_NAME | utjson_INTERNED_NAME);
+            object->parent = target;
+
+            if (position < target->used)
+            {
+                // the replacement takes over the slot, the key bytes move to the new node
+                utjson *replaced = target->children[position];
+                target->children[position] = object;
+                if (member)
+                {
+                    member->hh.key = object->name;
+                }
                 utjson_destruct(replaced);
+                return object;
             }
-            return object;
+            if (member_insert(target, object, key))
+                return object;
         }
         errno = ENOMEM;
         return NULL;
@@ -327,6 +849,44 @@ utjson *utjson_set(utjson *target, char *name, utjson *object)
     return NULL;
 }
 
+static utjson *object_set(utjson *target, char *name, utjson *object, uint8_t name_flags)
+{
+    return object_store(target, name, object, name_flags, NULL);
+}
+
+/**
+ * Sets the named child object
+ *
+ * @param target
+ * @param name
+ * @param object
+ * @return utjson *
+ */
+utjson *utjson_set(utjson *target, char *name, utjson *object)
+{
+    return object_set(target, name, object, 0);
+}
+
+/**
+ * Sets the named child object, its name taken from the pool
+ *
+ * @param target
+ * @param pool
+ * @param name
+ * @param object
+ * @return utjson *
+ */
+utjson *utjson_setInterned(utjson *target, utjson_intern *pool, const char *name, utjson *object)
+{
+    const char *interned = name ? utjson_internString(pool, name, strlen(name)) : NULL;
+    if (!interned)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    return object_set(target, (char *)interned, object, utjson_BORROWED_NAME | utjson_INTERNED_NAME);
+}
+
 /**
  * Sets the named Null child
  *
@@ -349,7 +909,7 @@ utjson *utjson_setNull(utjson *target, char *name)
  */
 utjson *utjson_setBool(utjson *target, char *name, bool value)
 {
-    utjson *object = utjson_createBool(value);
+    utjson *object = utjson_createBoolIn(node_arena(target), value);
     if (!utjson_set(target, name, object))
     {
         object = utjson_destruct(object);
@@ -367,7 +927,25 @@ utjson *utjson_setBool(utjson *target, char *name, bool value)
  */
 utjson *utjson_setNumber(utjson *target, char *name, double value)
 {
-    utjson *object = utjson_createNumber(value);
+    utjson *object = utjson_createNumberIn(node_arena(target), value);
+    if (!utjson_set(target, name, object))
+    {
+        object = utjson_destruct(object);
+    }
+    return object;
+}
+
+/**
+ * Sets the named integer child
+ *
+ * @param target
+ * @param name
+ * @param value
+ * @return utjson*
+ */
+utjson *utjson_setInt64(utjson *target, char *name, int64_t value)
+{
+    utjson *object = utjson_createInt64In(node_arena(target), value);
     if (!utjson_set(target, name, object))
     {
         object = utjson_destruct(object);
@@ -385,7 +963,7 @@ utjson *utjson_setNumber(utjson *target, char *name, double value)
  */
 utjson *utjson_setString(utjson *target, char *name, char *value)
 {
-    utjson *object = utjson_createString(value);
+    utjson *object = utjson_createStringIn(node_arena(target), value);
     if (!utjson_set(target, name, object))
     {
         object = utjson_destruct(object);
@@ -402,7 +980,7 @@ utjson *utjson_setString(utjson *target, char *name, char *value)
  */
 utjson *utjson_setArray(utjson *target, char *name)
 {
-    utjson *object = utjson_createArray();
+    utjson *object = utjson_createArrayIn(node_arena(target));
     if (!utjson_set(target, name, object))
     {
         object = utjson_destruct(object);
@@ -419,7 +997,7 @@ utjson *utjson_setArray(utjson *target, char *name)
  */
 utjson *utjson_setObject(utjson *target, char *name)
 {
-    utjson *object = utjson_createObject();
+    utjson *object = utjson_createObjectIn(node_arena(target));
     if (!utjson_set(target, name, object))
     {
         object = utjson_destruct(object);
@@ -427,6 +1005,23 @@ utjson *utjson_setObject(utjson *target, char *name)
     return object;
 }
 
+/**
+ * Makes room for at least capacity elements in the array
+ *
+ * @param array
+ * @param capacity
+ * @return utjson*
+ */
+utjson *utjson_arrayReserve(utjson *array, size_t capacity)
+{
+    if (utjson_IS(ARRAY, array))
+    {
+        return children_reserve(array, capacity) ? array : NULL;
+    }
+    errno = EINVAL;
+    return NULL;
+}
+
 /**
  * Adds the object to array
  *
@@ -440,24 +1035,14 @@ utjson *utjson_add(utjson *target, utjson *object)
     {
         if (!object)
         {
-            object = utjson_createNull();
+            object = utjson_createNullIn(target->arena);
         }
-        if (object)
+        if (object && children_append(target, object))
         {
-            if (target->allocated <= target->used)
-            {
-                target->allocated += utjson_ARRAY_INCREMENT;
-                target->children = realloc(target->children, target->allocated * sizeof(struct utjson *));
-            }
-            target->children[target->used++] = object;
-            object->parent = target;
             return object;
         }
-        else
-        {
-            errno = ENOMEM;
-            return NULL;
-        }
+        errno = ENOMEM;
+        return NULL;
     }
     errno = EINVAL;
     return NULL;
@@ -483,7 +1068,7 @@ utjson *utjson_addNull(utjson *target)
  */
 utjson *utjson_addBool(utjson *target, bool value)
 {
-    utjson *object = utjson_createBool(value);
+    utjson *object = utjson_createBoolIn(node_arena(target), value);
     if (!utjson_add(target, object))
     {
         object = utjson_destruct(object);
@@ -500,7 +1085,24 @@ utjson *utjson_addBool(utjson *target, bool value)
  */
 utjson *utjson_addNumber(utjson *target, double value)
 {
-    utjson *object = utjson_createNumber(value);
+    utjson *object = utjson_createNumberIn(node_arena(target), value);
+    if (!utjson_add(target, object))
+    {
+        object = utjson_destruct(object);
+    }
+    return object;
+}
+
+/**
+ * Adds the integer to array
+ *
+ * @param target
+ * @param value
+ * @return utjson*
+ */
+utjson *utjson_addInt64(utjson *target, int64_t value)
+{
+    utjson *object = utjson_createInt64In(node_arena(target), value);
     if (!utjson_add(target, object))
     {
         object = utjson_destruct(object);
@@ -517,7 +1119,7 @@ utjson *utjson_addNumber(utjson *target, double value)
  */
 utjson *utjson_addString(utjson *target, char *value)
 {
-    utjson *object = utjson_createString(value);
+    utjson *object = utjson_createStringIn(node_arena(target), value);
     if (!utjson_add(target, object))
     {
         object = utjson_destruct(object);
@@ -533,7 +1135,7 @@ utjson *utjson_addString(utjson *target, char *value)
  */
 utjson *utjson_addArray(utjson *target)
 {
-    utjson *object = utjson_createArray();
+    utjson *object = utjson_createArrayIn(node_arena(target));
     if (!utjson_add(target, object))
     {
         object = utjson_destruct(object);
@@ -549,7 +1151,7 @@ utjson *utjson_addArray(utjson *target)
  */
 utjson *utjson_addObject(utjson *target)
 {
-    utjson *object = utjson_createObject();
+    utjson *object = utjson_createObjectIn(node_arena(target));
     if (!utjson_add(target, object))
     {
         object = utjson_destruct(object);
@@ -568,14 +1170,66 @@ utjson *utjson_get(utjson *object, char *name)
 {
     if (utjson_IS(OBJECT, object) && name)
     {
-        utjson *item = NULL;
-        HASH_FIND_STR(*(object->children), name, item);
-        return item;
+        size_t position = member_find(object, name, 0, NULL, NULL);
+        return position < object->used ? object->children[position] : NULL;
+    }
+    errno = EINVAL;
+    return NULL;
+}
+
+/**
+ * Compiles a name into a key with its length and hash
+ *
+ * @param name
+ * @return utjson_key
+ */
+utjson_key utjson_keyCompile(const char *name)
+{
+    utjson_key key = {.name = name};
+    if (name)
+    {
+        key.length = strlen(name);
+        HASH_VALUE(name, key.length, key.hash);
+    }
+    return key;
+}
+
+/**
+ * Gets an element from an object by compiled key
+ *
+ * @param object
+ * @param key
+ * @return utjson*
+ */
+utjson *utjson_getByKey(utjson *object, const utjson_key *key)
+{
+    if (utjson_IS(OBJECT, object) && key && key->name)
+    {
+        size_t position = member_find(object, key->name, 0, key, NULL);
+        return position < object->used ? object->children[position] : NULL;
     }
     errno = EINVAL;
     return NULL;
 }
 
+/**
+ * Sets the child object named by a compiled key
+ *
+ * @param target
+ * @param key
+ * @param object
+ * @return utjson*
+ */
+utjson *utjson_setByKey(utjson *target, const utjson_key *key, utjson *object)
+{
+    if (!key || !key->name)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    return object_store(target, (char *)key->name, object, 0, key);
+}
+
 /**
  * Gets an element from an array by number
  *
@@ -583,7 +1237,7 @@ utjson *utjson_get(utjson *object, char *name)
  * @param index
  * @return utjson*
  */
-utjson *utjson_select(utjson *array, uint16_t index)
+utjson *utjson_select(utjson *array, size_t index)
 {
     if (utjson_IS(ARRAY, array))
     {
@@ -598,179 +1252,570 @@ utjson *utjson_select(utjson *array, uint16_t index)
     return NULL;
 }
 
-static char *skip_whitespace(char *c)
+#define current(ctx) ((ctx)->cursor < (ctx)->end ? *(ctx)->cursor : '\0')
+
+static void skip_whitespace(parse_context *ctx)
+{
+    while (ctx->cursor < ctx->end && isspace((unsigned char)*ctx->cursor))
+        ctx->cursor++;
+}
+
+static bool match_literal(parse_context *ctx, const char *literal, size_t length)
 {
-    while (*c && isspace((unsigned char)*c))
-        c++;
-    return c;
+    if ((size_t)(ctx->end - ctx->cursor) < length || memcmp(ctx->cursor, literal, length) != 0)
+        return false;
+    ctx->cursor += length;
+    return true;
 }
 
-static utjson *parse_value(char **source);
+static utjson *parse_value(parse_context *ctx);
 
-static utjson *parse_null(char **source)
+static utjson *parse_null(parse_context *ctx)
 {
-    if (strncmp(*source, "null", 4) == 0)
-    {
-        *source += 4;
-        return utjson_createNull();
-    }
+    if (match_literal(ctx, "null", 4))
+        return utjson_createNullIn(ctx->arena);
     return NULL;
 }
 
-static utjson *parse_bool(char **source)
+static utjson *parse_bool(parse_context *ctx)
 {
-    if (strncmp(*source, "true", 4) == 0)
-    {
-        *source += 4;
-        return utjson_createBool(true);
-    }
-    else if (strncmp(*source, "false", 5) == 0)
-    {
-        *source += 5;
-        return utjson_createBool(false);
-    }
+    if (match_literal(ctx, "true", 4))
+        return utjson_createBoolIn(ctx->arena, true);
+    if (match_literal(ctx, "false", 5))
+        return utjson_createBoolIn(ctx->arena, false);
     return NULL;
 }
 
-static utjson *parse_number(char **source)
+static bool scan_number(parse_context *ctx, double *number)
+{
+    size_t length = utjson_numberParse(ctx->cursor, ctx->end, number);
+    if (!length)
+        return false; // No valid number
+    ctx->cursor += length;
+    return true;
+}
+
+static utjson *parse_number(parse_context *ctx)
 {
-    char *end;
-    double value = strtod(*source, &end);
-    if (end == *source)
+    utjson_number_token token;
+    size_t length = utjson_numberScan(ctx->cursor, ctx->end, &token);
+    if (!length)
         return NULL; // No valid number
-    *source = end;
-    return utjson_createNumber(value);
+    ctx->cursor += length;
+
+    if (ctx->integers && token.integral)
+    {
+        if (!token.negative)
+            return utjson_createUint64In(ctx->arena, token.magnitude);
+        if (token.magnitude <= (uint64_t)INT64_MAX + 1)
+            return utjson_createInt64In(ctx->arena, (int64_t)(0 - token.magnitude));
+    }
+    return utjson_createNumberIn(ctx->arena, token.value);
+}
+
+// the raw bytes are checked: escapes only decode to well-formed UTF-8
+static bool check_utf8(parse_context *ctx, const char *start, size_t len)
+{
+    if (!ctx->validate_utf8 || utjson_utf8Valid(start, len))
+        return true;
+    errno = EILSEQ;
+    return false;
 }
 
-static utjson *parse_string(char **source)
+static utjson *build_string(parse_context *ctx, char *start, size_t len)
 {
-    if (**source != '"')
+    if (!check_utf8(ctx, start, len))
         return NULL;
-    (*source)++;
-    char *start = *source;
-    while (**source && **source != '"')
-        (*source)++;
-    if (**source != '"')
-        return NULL; // Unterminated string
-    size_t len = *source - start;
-    char *value = strndup(start, len);
-    (*source)++;
 
     // Check if the string follows the pointer format "<:type:>pointer"
-    if (strncmp(value, "<:", 2) == 0)
+    if (len >= 2 && strncmp(start, "<:", 2) == 0)
     {
-        char *end = strstr(value, ":>pointer");
+        char *end = memmem(start, len, ":>pointer", 9);
         if (end)
         {
-            size_t type_len = end - (value + 2);
-            char *type = strndup(value + 2, type_len);
-            utjson *pointer_obj = utjson_createPointer(NULL, type);
+            // the printer escapes the type like any other string
+            size_t type_length = end - (start + 2);
+            char *type = malloc(type_length + 1);
+            size_t size = type ? utjson_unescape(type, start + 2, type_length) : SIZE_MAX;
+            utjson *pointer_obj = NULL;
+            if (size != SIZE_MAX)
+            {
+                type[size] = '\0';
+                pointer_obj = utjson_createPointerIn(ctx->arena, NULL, type);
+            }
             free(type);
-            free(value);
             return pointer_obj;
         }
     }
 
-    utjson *str_obj = utjson_createString(value);
-    free(value);
+    utjson *str_obj = node_new(ctx->arena, utjson_STRING);
+    if (!str_obj)
+        return NULL;
+    if (ctx->intern_values && len <= utjson_INTERN_VALUE_MAX)
+    {
+        // the scratch is free until the member key is built
+        ctx->scratch.length = 0;
+        size_t size =
+            utjson_bufferReserve(&ctx->scratch, len) ? utjson_unescape(ctx->scratch.data, start, len) : SIZE_MAX;
+        if (size != SIZE_MAX)
+        {
+            str_obj->string = (char *)utjson_internString(ctx->intern, ctx->scratch.data, size);
+            str_obj->flags |= utjson_BORROWED_STRING;
+        }
+    }
+    else if (ctx->in_place)
+    {
+        // decoded over the source, the closing quote side becomes the terminator
+        size_t size = utjson_unescape(start, start, len);
+        if (size != SIZE_MAX)
+        {
+            start[size] = '\0';
+            str_obj->string = start;
+            str_obj->flags |= utjson_BORROWED_STRING;
+        }
+    }
+    else
+    {
+        char *string = ctx->arena ? utjson_arenaAlloc(ctx->arena, len + 1) : malloc(len + 1);
+        size_t size = string ? utjson_unescape(string, start, len) : SIZE_MAX;
+        if (size != SIZE_MAX)
+        {
+            string[size] = '\0';
+            str_obj->string = string;
+        }
+        else if (!ctx->arena)
+        {
+            free(string);
+        }
+    }
+    if (!str_obj->string)
+        return utjson_destruct(str_obj);
     return str_obj;
 }
 
-static utjson *parse_array(char **source)
+// who owns the keys build_key() returns
+#define key_flags(ctx) ((ctx)->intern      ? utjson_BORROWED_NAME | utjson_INTERNED_NAME \
+                        : (ctx)->in_place ? utjson_BORROWED_NAME                        \
+                                          : 0)
+
+static char *build_key(parse_context *ctx, char *start, size_t len)
+{
+    if (!check_utf8(ctx, start, len))
+        return NULL;
+    // keys without escapes are pooled straight from the source
+    if (ctx->intern && !memchr(start, '\\', len))
+        return (char *)utjson_internString(ctx->intern, start, len);
+    char *key = start;
+    if (!ctx->in_place || ctx->intern)
+    {
+        ctx->scratch.length = 0;
+        if (!utjson_bufferReserve(&ctx->scratch, len))
+            return NULL;
+        key = ctx->scratch.data;
+    }
+    size_t size = utjson_unescape(key, start, len);
+    if (size == SIZE_MAX)
+        return NULL;
+    if (ctx->intern)
+        return (char *)utjson_internString(ctx->intern, key, size);
+    key[size] = '\0';
+    return key;
+}
+
+static bool scan_string(parse_context *ctx, char **start, size_t *len)
+{
+    if (current(ctx) != '"')
+        return false;
+    ctx->cursor++;
+    char *quote = utjson_stringEnd(ctx->cursor, ctx->end);
+    if (!quote)
+        return false; // Unterminated string
+    *start = ctx->cursor;
+    *len = quote - ctx->cursor;
+    ctx->cursor = quote + 1;
+    return true;
+}
+
+static utjson *parse_string(parse_context *ctx)
+{
+    char *start;
+    size_t len;
+    if (!scan_string(ctx, &start, &len))
+        return NULL;
+    return build_string(ctx, start, len);
+}
+
+static utjson *parse_array(parse_context *ctx)
 {
-    if (**source != '[')
+    if (current(ctx) != '[')
+        return NULL;
+    ctx->cursor++;
+    utjson *array = utjson_createArrayIn(ctx->arena);
+    if (!array)
         return NULL;
-    (*source)++;
-    utjson *array = utjson_createArray();
 
-    while (**source && **source != ']')
+    skip_whitespace(ctx);
+    if (current(ctx) == ']')
+    {
+        ctx->cursor++;
+        return array;
+    }
+    // every element is followed by ',' and another element, or by the closing ']'
+    for (;;)
     {
-        *source = skip_whitespace(*source);
-        utjson *element = parse_value(source);
-        if (!element)
+        utjson *element = parse_value(ctx);
+        if (!element || !utjson_add(array, element))
         {
-            utjson_destruct(array);
-            return NULL;
+            utjson_destruct(element);
+            return utjson_destruct(array);
+        }
+
+        skip_whitespace(ctx);
+        if (current(ctx) == ']')
+        {
+            ctx->cursor++;
+            return array;
+        }
+        if (current(ctx) != ',')
+            return utjson_destruct(array);
+        ctx->cursor++;
+    }
+}
+
+static utjson *parse_object(parse_context *ctx)
+{
+    if (current(ctx) != '{')
+        return NULL;
+    ctx->cursor++;
+    utjson *object = utjson_createObjectIn(ctx->arena);
+    if (!object)
+        return NULL;
+
+    skip_whitespace(ctx);
+    if (current(ctx) == '}')
+    {
+        ctx->cursor++;
+        return object;
+    }
+    // every member is followed by ',' and another member, or by the closing '}'
+    for (;;)
+    {
+        skip_whitespace(ctx);
+        char *start;
+        size_t len;
+        if (!scan_string(ctx, &start, &len))
+            return utjson_destruct(object);
+
+        skip_whitespace(ctx);
+        if (current(ctx) != ':')
+            return utjson_destruct(object);
+        ctx->cursor++;
+
+        utjson *value = parse_value(ctx);
+        // nested members reuse the scratch, so the key is built only now
+        char *key = value ? build_key(ctx, start, len) : NULL;
+        if (!key || !object_set(object, key, value, key_flags(ctx)))
+        {
+            utjson_destruct(value);
+            return utjson_destruct(object);
+        }
+
+        skip_whitespace(ctx);
+        if (current(ctx) == '}')
+        {
+            ctx->cursor++;
+            return object;
         }
+        if (current(ctx) != ',')
+            return utjson_destruct(object);
+        ctx->cursor++;
+    }
+}
+
+static utjson *parse_value(parse_context *ctx)
+{
+    skip_whitespace(ctx);
+    char c = current(ctx);
+    if (c == 'n')
+        return parse_null(ctx);
+    if (c == 't' || c == 'f')
+        return parse_bool(ctx);
+    if (c == '"')
+        return parse_string(ctx);
+    if ((c == '-' || isdigit((unsigned char)c)))
+        return parse_number(ctx);
+    if (c == '[')
+        return parse_array(ctx);
+    if (c == '{')
+        return parse_object(ctx);
+    return NULL;
+}
+
+/**
+ * Parses the value at the cursor
+ *
+ * @param ctx
+ * @return utjson*
+ */
+utjson *utjson_parseValue(parse_context *ctx)
+{
+    return parse_value(ctx);
+}
+
+/**
+ * Reads the number at the cursor without creating a node
+ *
+ * @param ctx
+ * @param number
+ * @return true | false
+ */
+bool utjson_parseNumber(parse_context *ctx, double *number)
+{
+    return scan_number(ctx, number);
+}
+
+/**
+ * Writes the text of a BOOL or NUMBER node
+ *
+ * @param object
+ * @param text
+ * @return size_t
+ */
+size_t utjson_nodeFormat(const utjson *object, char *text)
+{
+    return node_format(object, text);
+}
+
+/**
+ * Builds a key from raw member name bytes
+ *
+ * @param ctx
+ * @param start
+ * @param length
+ * @return char*
+ */
+char *utjson_parseKey(parse_context *ctx, char *start, size_t length)
+{
+    return build_key(ctx, start, length);
+}
+
+/**
+ * Sets the named child object, optionally borrowing the name
+ *
+ * @param target
+ * @param name
+ * @param object
+ * @param borrow_name
+ * @return utjson*
+ */
+utjson *utjson_setMember(utjson *target, char *name, utjson *object, uint8_t name_flags)
+{
+    return object_set(target, name, object, name_flags);
+}
+
+#define is_json_whitespace(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+
+/**
+ * What the indexed parser expects from the next structural character
+ */
+typedef enum
+{
+    EXPECT_VALUE,        /**< Any value */
+    EXPECT_VALUE_OR_END, /**< First element of an array or ']' */
+    EXPECT_KEY,          /**< Member key */
+    EXPECT_KEY_OR_END,   /**< First member key of an object or '}' */
+    EXPECT_SEPARATOR,    /**< ',' or the end of the current container */
+} index_expect;
+
+static utjson *index_scalar(parse_context *ctx, utjson_structural *index, char *source, size_t position)
+{
+    if (source[position] == '"')
+    {
+        size_t closing = utjson_structuralNext(index);
+        if (closing == SIZE_MAX || source[closing] != '"')
+            return NULL; // Unterminated string
+        return build_string(ctx, source + position + 1, closing - position - 1);
+    }
 
-        utjson_add(array, element);
+    ctx->cursor = source + position;
+    utjson *value = parse_value(ctx);
+    // a literal or number has to end right at a delimiter
+    char c = current(ctx);
+    if (value && c && !is_json_whitespace(c) && !strchr(",:]}[{\"", c))
+    {
+        value = utjson_destruct(value);
+    }
+    return value;
+}
 
-        *source = skip_whitespace(*source);
-        if (**source == ',')
+static bool index_push(utjson ***stack, size_t *depth, size_t *allocated, utjson *container)
+{
+    if (*depth == *allocated)
+    {
+        size_t grown_size = *allocated ? *allocated * 2 : utjson_ARRAY_INCREMENT;
+        utjson **grown = realloc(*stack, grown_size * sizeof(utjson *));
+        if (!grown)
         {
-            (*source)++;
+            errno = ENOMEM;
+            return false;
         }
+        *stack = grown;
+        *allocated = grown_size;
     }
-    if (**source == ']')
-        (*source)++;
-    return array;
+    (*stack)[(*depth)++] = container;
+    return true;
 }
 
-static utjson *parse_object(char **source)
+static utjson *index_parse(parse_context *ctx, char *source, size_t length)
 {
-    if (**source != '{')
+    utjson_structural index;
+    if (!utjson_structuralInit(&index, source, length))
         return NULL;
-    (*source)++;
-    utjson *object = utjson_createObject();
 
-    while (**source && **source != '}')
+    utjson *root = NULL;
+    utjson **stack = NULL;
+    size_t depth = 0;
+    size_t allocated = 0;
+    char *key = NULL;
+    index_expect expect = EXPECT_VALUE;
+    bool failed = false;
+
+    size_t position;
+    while (!failed && (position = utjson_structuralNext(&index)) != SIZE_MAX)
     {
-        *source = skip_whitespace(*source);
-        utjson *key = parse_string(source);
-        if (!key)
+        char c = source[position];
+        utjson *container = depth ? stack[depth - 1] : NULL;
+
+        if (expect == EXPECT_SEPARATOR)
         {
-            utjson_destruct(object);
-            return NULL;
+            if (!container)
+                break; // trailing content after the document is ignored
+            if (c == ',')
+            {
+                expect = utjson_IS(ARRAY, container) ? EXPECT_VALUE : EXPECT_KEY;
+            }
+            else if (c == (utjson_IS(ARRAY, container) ? ']' : '}'))
+            {
+                depth--;
+            }
+            else
+            {
+                failed = true;
+            }
+            continue;
         }
 
-        *source = skip_whitespace(*source);
-        if (**source != ':')
+        if (expect == EXPECT_KEY || expect == EXPECT_KEY_OR_END)
         {
-            utjson_destruct(object);
-            utjson_destruct(key);
-            return NULL;
+            if (c == '}' && expect == EXPECT_KEY_OR_END)
+            {
+                depth--;
+                expect = EXPECT_SEPARATOR;
+                continue;
+            }
+            size_t closing = utjson_structuralNext(&index);
+            size_t colon = utjson_structuralNext(&index);
+            if (c != '"' || closing == SIZE_MAX || source[closing] != '"' || colon == SIZE_MAX || source[colon] != ':')
+            {
+                failed = true;
+                continue;
+            }
+            key = build_key(ctx, source + position + 1, closing - position - 1);
+            failed = !key;
+            expect = EXPECT_VALUE;
+            continue;
         }
-        (*source)++;
 
-        *source = skip_whitespace(*source);
-        utjson *value = parse_value(source);
-        if (!value)
+        if (c == ']' && expect == EXPECT_VALUE_OR_END)
         {
-            utjson_destruct(object);
-            utjson_destruct(key);
-            return NULL;
+            depth--;
+            expect = EXPECT_SEPARATOR;
+            continue;
         }
 
-        utjson_set(object, key->string, value);
-        utjson_destruct(key);
+        utjson *value = NULL;
+        if (c == '[')
+        {
+            value = utjson_createArrayIn(ctx->arena);
+            expect = EXPECT_VALUE_OR_END;
+        }
+        else if (c == '{')
+        {
+            value = utjson_createObjectIn(ctx->arena);
+            expect = EXPECT_KEY_OR_END;
+        }
+        else if (c != ']' && c != '}' && c != ',' && c != ':')
+        {
+            value = index_scalar(ctx, &index, source, position);
+            expect = EXPECT_SEPARATOR;
+        }
 
-        *source = skip_whitespace(*source);
-        if (**source == ',')
+        if (!value)
+        {
+            failed = true;
+            continue;
+        }
+        if (!container)
+        {
+            root = value;
+        }
+        else if (!(utjson_IS(ARRAY, container) ? utjson_add(container, value)
+                                               : object_set(container, key, value, key_flags(ctx))))
+        {
+            utjson_destruct(value);
+            failed = true;
+            continue;
+        }
+        if (expect != EXPECT_SEPARATOR && !index_push(&stack, &depth, &allocated, value))
         {
-            (*source)++;
+            failed = true;
         }
     }
-    if (**source == '}')
-        (*source)++;
-    return object;
+
+    if (depth || expect != EXPECT_SEPARATOR)
+    {
+        failed = true; // unterminated container or empty input
+    }
+    free(stack);
+    utjson_structuralFree(&index);
+    if (failed)
+    {
+        root = utjson_destruct(root);
+    }
+    return root;
 }
 
-static utjson *parse_value(char **source)
-{
-    *source = skip_whitespace(*source);
-    if (**source == 'n')
-        return parse_null(source);
-    if (**source == 't' || **source == 'f')
-        return parse_bool(source);
-    if (**source == '"')
-        return parse_string(source);
-    if ((**source == '-' || isdigit((unsigned char)**source)))
-        return parse_number(source);
-    if (**source == '[')
-        return parse_array(source);
-    if (**source == '{')
-        return parse_object(source);
-    return NULL;
+static utjson *parse_document(utjson_arena *arena, utjson_intern *intern, char *source, size_t length, unsigned flags)
+{
+    parse_context ctx = {
+        .cursor = source,
+        .end = source + length,
+        .arena = arena,
+        .in_place = flags & utjson_PARSE_IN_PLACE,
+        .integers = flags & utjson_PARSE_INTEGERS,
+        .intern = intern,
+        .intern_values = intern && (flags & utjson_PARSE_INTERN_VALUES),
+        .validate_utf8 = flags & utjson_PARSE_VALIDATE_UTF8,
+    };
+    bool indexed = (flags & utjson_PARSE_INDEXED) ||
+                   (!(flags & utjson_PARSE_RECURSIVE) && length >= utjson_PARSE_INDEX_THRESHOLD);
+    utjson *root = indexed ? index_parse(&ctx, source, length) : parse_value(&ctx);
+    utjson_bufferFree(&ctx.scratch);
+    return root;
+}
+
+/**
+ * Parses length bytes at source with the engine picked by flags
+ *
+ * @param arena
+ * @param source
+ * @param length
+ * @param flags
+ * @return utjson*
+ */
+utjson *utjson_parseDocument(utjson_arena *arena, char *source, size_t length, unsigned flags)
+{
+    return parse_document(arena, NULL, source, length, flags);
 }
 
 /**
@@ -780,90 +1825,299 @@ static utjson *parse_value(char **source)
  * @return utjson*
  */
 utjson *utjson_parse(char *source)
+{
+    return utjson_parseWith(source, utjson_PARSE_DEFAULT);
+}
+
+/**
+ * Parse a JSON string into utjson* with the chosen engine
+ *
+ * @param source
+ * @param flags
+ * @return utjson*
+ */
+utjson *utjson_parseWith(char *source, unsigned flags)
 {
     if (!source)
         return NULL;
-    char *ptr = source;
-    return parse_value(&ptr);
+    return parse_document(NULL, NULL, source, strlen(source), flags);
 }
 
-static void append_str(char **dest, const char *format, ...)
+/**
+ * Parse a JSON buffer in place: strings and keys point into the buffer
+ *
+ * @param buffer
+ * @param length
+ * @return utjson*
+ */
+utjson *utjson_parseInPlace(char *buffer, size_t length)
 {
-    va_list args;
-    char *temp;
-    va_start(args, format);
-    vasprintf(&temp, format, args);
-    va_end(args);
+    if (!buffer)
+        return NULL;
+    return parse_document(NULL, NULL, buffer, length, utjson_PARSE_IN_PLACE);
+}
 
-    size_t len = (*dest ? strlen(*dest) : 0) + strlen(temp) + 1;
-    *dest = realloc(*dest, len);
-    strcat(*dest, temp);
-    free(temp);
+/**
+ * Parse a JSON string into utjson* placed in the arena
+ *
+ * @param arena
+ * @param source
+ * @return utjson*
+ */
+utjson *utjson_parseInArena(utjson_arena *arena, char *source)
+{
+    if (!source)
+        return NULL;
+    return parse_document(arena, NULL, source, strlen(source), utjson_PARSE_DEFAULT);
 }
 
 /**
- * Prints JSON into new string
+ * Parse a JSON buffer with member names taken from the pool
  *
- * @param object
- * @param readable
- * @return char*
+ * @param pool
+ * @param source
+ * @param length
+ * @param flags
+ * @return utjson*
  */
-char *utjson_print(utjson *object, bool readable)
+utjson *utjson_parseInterned(utjson_intern *pool, char *source, size_t length, unsigned flags)
+{
+    if (!pool || !source)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    return parse_document(NULL, pool, source, length, flags);
+}
+
+/**
+ * Makes room for at least size more bytes (plus the terminating NUL)
+ *
+ * @param buffer
+ * @param size
+ * @return true | false
+ */
+bool utjson_bufferReserve(utjson_buffer *buffer, size_t size)
+{
+    size_t needed = buffer->length + size + 1;
+    if (needed <= buffer->allocated)
+        return true;
+
+    size_t allocated = buffer->allocated ? buffer->allocated : utjson_BUFFER_INITIAL;
+    while (allocated < needed)
+        allocated *= 2;
+
+    char *data = realloc(buffer->data, allocated);
+    if (!data)
+    {
+        errno = ENOMEM;
+        return false;
+    }
+    buffer->data = data;
+    buffer->allocated = allocated;
+    return true;
+}
+
+/**
+ * Releases the buffer storage
+ *
+ * @param buffer
+ */
+void utjson_bufferFree(utjson_buffer *buffer)
+{
+    if (buffer)
+    {
+        FREE_AND_NULL(buffer->data);
+        buffer->length = 0;
+        buffer->allocated = 0;
+    }
+}
+
+static bool buffer_append(utjson_buffer *buffer, const char *data, size_t length)
+{
+    if (!utjson_bufferReserve(buffer, length))
+        return false;
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+    return true;
+}
+
+#define buffer_literal(buffer, literal) buffer_append(buffer, literal, sizeof(literal) - 1)
+
+/**
+ * Appends length bytes of text escaped as RFC 8259 requires, without quotes
+ *
+ * Runs without special bytes, found 16 or 32 at a time, are copied in bulk.
+ */
+static bool buffer_escaped(utjson_buffer *buffer, const char *text, size_t length)
+{
+    static const char hex[] = "0123456789abcdef";
+    if (!utjson_bufferReserve(buffer, length))
+        return false;
+    for (;;)
+    {
+        size_t span = utjson_escapeSpan(text, length);
+        if (!buffer_append(buffer, text, span))
+            return false;
+        if (span == length)
+            return true;
+
+        char c = text[span];
+        char escape[6] = {'\\', c};
+        size_t size = 2;
+        switch (c)
+        {
+        case '"':
+        case '\\':
+            break;
+        case '\b':
+            escape[1] = 'b';
+            break;
+        case '\f':
+            escape[1] = 'f';
+            break;
+        case '\n':
+            escape[1] = 'n';
+            break;
+        case '\r':
+            escape[1] = 'r';
+            break;
+        case '\t':
+            escape[1] = 't';
+            break;
+        default:
+            memcpy(escape + 1, "u00", 3);
+            escape[4] = hex[(uint8_t)c >> 4];
+            escape[5] = hex[c & 0xF];
+            size = 6;
+            break;
+        }
+        if (!buffer_append(buffer, escape, size))
+            return false;
+        text += span + 1;
+        length -= span + 1;
+    }
+}
+
+// text as a quoted JSON string
+static bool buffer_string(utjson_buffer *buffer, const char *text)
+{
+    return buffer_literal(buffer, "\"") && buffer_escaped(buffer, text, strlen(text)) && buffer_literal(buffer, "\"");
+}
+
+static bool buffer_number(utjson_buffer *buffer, const utjson *object)
+{
+    if (!utjson_bufferReserve(buffer, utjson_NUMBER_TEXT))
+        return false;
+    buffer->length += node_format(object, buffer->data + buffer->length);
+    return true;
+}
+
+static bool print_value(utjson_buffer *buffer, utjson *object, bool readable)
 {
     if (!object)
-        return strdup("null");
-    char *output = strdup("");
+        return buffer_literal(buffer, "null");
 
     switch (object->type)
     {
     case utjson_NULL:
-        append_str(&output, "null");
-        break;
+        return buffer_literal(buffer, "null");
     case utjson_BOOL:
-        append_str(&output, object->number ? "true" : "false");
-        break;
+        return object->number ? buffer_literal(buffer, "true") : buffer_literal(buffer, "false");
     case utjson_NUMBER:
-        append_str(&output, "%g", object->number);
-        break;
+        return buffer_number(buffer, object);
     case utjson_STRING:
-        append_str(&output, "\"%s\"", object->string);
-        break;
+        if (!object->string)
+            return buffer_literal(buffer, "null");
+        return buffer_string(buffer, object->string);
     case utjson_ARRAY:
-        append_str(&output, "[");
-        for (uint16_t i = 0; i < object->used; i++)
+        if (!buffer_literal(buffer, "["))
+            return false;
+        for (size_t i = 0; i < object->used; i++)
         {
-            if (i > 0)
-                append_str(&output, ",%s", readable ? " " : "");
-            char *item_str = utjson_print(object->children[i], readable);
-            append_str(&output, "%s", item_str);
-            free(item_str);
+            if (i > 0 && !(readable ? buffer_literal(buffer, ", ") : buffer_literal(buffer, ",")))
+                return false;
+            if (!print_value(buffer, object->children[i], readable))
+                return false;
         }
-        append_str(&output, "]");
-        break;
+        return buffer_literal(buffer, "]");
     case utjson_OBJECT:
-        append_str(&output, "{");
-        utjson *entry, *tmp;
-        HASH_ITER(hh, *(object->children), entry, tmp)
-        {
-            append_str(&output, "\"%s\":%s", entry->name, readable ? " " : "");
-            char *value_str = utjson_print(entry, readable);
-            append_str(&output, "%s,", value_str);
-            free(value_str);
-        }
-        if (output[strlen(output) - 1] == ',')
-        {
-            output[strlen(output) - 1] = '}';
-        }
-        else
+    {
+        if (!buffer_literal(buffer, "{"))
+            return false;
+        for (size_t i = 0; i < object->used; i++)
         {
-            append_str(&output, "}");
+            utjson *entry = object->children[i];
+            if (i > 0 && !(readable ? buffer_literal(buffer, ", ") : buffer_literal(buffer, ",")))
+                return false;
+            if (!buffer_string(buffer, entry->name) ||
+                !(readable ? buffer_literal(buffer, ": ") : buffer_literal(buffer, ":")))
+                return false;
+            if (!print_value(buffer, entry, readable))
+                return false;
         }
-        break;
+        return buffer_literal(buffer, "}");
+    }
     case utjson_POINTER:
-        asprintf(&output, "\"<:%s:>pointer\"", object->pointer_type);
-        break;
+        return buffer_literal(buffer, "\"<:") &&
+               buffer_escaped(buffer, object->pointer_type, strlen(object->pointer_type)) &&
+               buffer_literal(buffer, ":>pointer\"");
+    }
+    return true;
+}
+
+/**
+ * Appends JSON to the buffer
+ *
+ * @param buffer
+ * @param object
+ * @param readable
+ * @return true | false
+ */
+bool utjson_printTo(utjson_buffer *buffer, utjson *object, bool readable)
+{
+    if (!buffer)
+    {
+        errno = EINVAL;
+        return false;
+    }
+    return print_value(buffer, object, readable);
+}
+
+/**
+ * Prints JSON into new string and reports its length
+ *
+ * @param object
+ * @param readable
+ * @param length
+ * @return char*
+ */
+char *utjson_printLen(utjson *object, bool readable, size_t *length)
+{
+    utjson_buffer buffer = {0};
+    if (!utjson_printTo(&buffer, object, readable))
+    {
+        utjson_bufferFree(&buffer);
+        return NULL;
+    }
+    if (length)
+    {
+        *length = buffer.length;
     }
-    return output;
+    return buffer.data;
+}
+
+/**
+ * Prints JSON into new string
+ *
+ * @param object
+ * @param readable
+ * @return char*
+ */
+char *utjson_print(utjson *object, bool readable)
+{
+    return utjson_printLen(object, readable, NULL);
 }
 
 /**
@@ -883,7 +2137,7 @@ utjson *utjson_detach(utjson *object)
     if (utjson_IS(ARRAY, parent))
     {
         // Remove from array
-        for (uint16_t i = 0; i < parent->used; i++)
+        for (size_t i = 0; i < parent->used; i++)
         {
             if (parent->children[i] == object)
             {
@@ -895,24 +2149,17 @@ utjson *utjson_detach(utjson *object)
     }
     else if (utjson_IS(OBJECT, parent))
     {
-        // Remove from hash table
-        HASH_DEL(*(parent->children), object);
+        // Remove from members and their index
+        member_remove(parent, object);
     }
     return object;
 }
 
-/**
- * Clones an object
- *
- * @param object
- * @return utjson*
- */
-utjson *utjson_clone(const utjson *object)
+static utjson *clone_node(const utjson *object)
 {
-    if (!object)
-        return NULL;
-
     utjson *copy = utjson_construct();
+    if (!copy)
+        return NULL;
     copy->type = object->type;
 
     switch (object->type)
@@ -920,32 +2167,59 @@ utjson *utjson_clone(const utjson *object)
     case utjson_BOOL:
         // fall through
     case utjson_NUMBER:
-        copy->number = object->number;
+        copy->flags = object->flags & (utjson_INTEGER | utjson_UNSIGNED);
+        copy->uinteger = object->uinteger; // all the bits, whichever member is in use
         break;
     case utjson_STRING:
-        copy->string = strdup(object->string);
+        copy->string = object->string ? strdup(object->string) : NULL;
         break;
     case utjson_ARRAY:
-        copy->allocated = object->allocated;
-        copy->used = object->used;
-        copy->children = calloc(copy->allocated, sizeof(utjson *));
-        for (uint16_t i = 0; i < object->used; i++)
+        children_reserve(copy, object->used);
+        for (size_t i = 0; i < object->used; i++)
         {
-            copy->children[i] = utjson_clone(object->children[i]);
+            utjson *element = clone_node(object->children[i]);
+            if (element && !children_append(copy, element))
+            {
+                utjson_destruct(element);
+            }
         }
         break;
     case utjson_OBJECT:
-    {
-        utjson *entry, *tmp, *new_entry;
-        HASH_ITER(hh, *(object->children), entry, tmp)
+        children_reserve(copy, object->used);
+        for (size_t i = 0; i < object->used; i++)
         {
-            new_entry = utjson_clone(entry);
-            HASH_ADD_KEYPTR(hh, *(copy->children), new_entry->name, strlen(new_entry->name), new_entry);
+            utjson *member = clone_node(object->children[i]);
+            if (member && !object_set(copy, object->children[i]->name, member, 0))
+            {
+                utjson_destruct(member);
+            }
         }
-    }
-    break;
+        break;
+    case utjson_POINTER:
+        copy->pointer = object->pointer;
+        copy->pointer_type = object->pointer_type ? strdup(object->pointer_type) : NULL;
+        break;
     default:
         break;
     }
     return copy;
 }
+
+/**
+ * Clones an object
+ *
+ * @param object
+ * @return utjson*
+ */
+utjson *utjson_clone(const utjson *object)
+{
+    if (!object)
+        return NULL;
+
+    utjson *copy = clone_node(object);
+    if (copy && object->name)
+    {
+        copy->name = strdup(object->name);
+    }
+    return copy;
+}
@@ -33,26 +33,146 @@ typedef enum
     utjson_OBJECT,  /**< JSON object with key-value pairs */
     utjson_POINTER, /**< Universal pointer type */
 } utjson_type;
+#define utjson_BORROWED_STRING 0x01 /**< string points into caller memory and is not freed */
+#define utjson_BORROWED_NAME 0x02   /**< name points into caller memory and is not freed */
+#define utjson_INTEGER 0x04         /**< NUMBER holds integer instead of number */
+#define utjson_UNSIGNED 0x08        /**< with utjson_INTEGER: the value is uinteger (above INT64_MAX) */
+#define utjson_INTERNED_NAME 0x10   /**< with utjson_BORROWED_NAME: name comes from a utjson_intern pool */
+#define utjson_MAPPED 0x20          /**< node lies in a read-only image from utjson_mapBinary() */
+
 #define utjson_IS(TYPE, object) (object && utjson_##TYPE == (object)->type)
 
-#define utjson_ARRAY_INCREMENT 16
+#define utjson_ARRAY_INCREMENT 16 /**< Initial capacity of arrays, doubled on every growth */
+#define utjson_BUFFER_INITIAL 256
+#define utjson_ARENA_BLOCK (64 * 1024)
+#define utjson_PARSE_INDEX_THRESHOLD 1024 /**< Inputs from this size on use the indexed engine by default */
+#define utjson_OBJECT_INDEX_THRESHOLD 8 /**< Objects with more members get a hash index, smaller ones are scanned */
+#define utjson_INTERN_VALUE_MAX 32 /**< Longest string value utjson_PARSE_INTERN_VALUES pools */
+#define utjson_LINES_BATCH (256 * 1024)    /**< Bytes of records a utjson_parseLines() worker takes at once */
+
+/**
+ * @brief Parser options for utjson_parseWith().
+ */
+typedef enum
+{
+    utjson_PARSE_DEFAULT = 0,        /**< Engine chosen by input size */
+    utjson_PARSE_RECURSIVE = 1 << 0, /**< Byte-by-byte recursive descent */
+    utjson_PARSE_INDEXED = 1 << 1,   /**< Two-stage: vectorized structural index, then tree building */
+    utjson_PARSE_IN_PLACE = 1 << 2,  /**< Strings and keys borrow the (modified) input, see utjson_parseInPlace() */
+    utjson_PARSE_UNORDERED = 1 << 3, /**< utjson_parseLines() delivers records as they complete */
+    utjson_PARSE_INTEGERS = 1 << 4,  /**< Integral tokens that fit 64 bits are kept exactly, see utjson_INTEGER */
+    utjson_PARSE_INTERN_VALUES = 1 << 5, /**< utjson_parseInterned() pools short string values as well */
+    utjson_PARSE_VALIDATE_UTF8 = 1 << 6, /**< Strings and keys that are not well-formed UTF-8 fail the parse (EILSEQ) */
+} utjson_parse_flags;
+
+/**
+ * @brief Region allocator for whole documents.
+ *
+ * Nodes, keys, strings and child tables created in an arena are released
+ * together by utjson_arenaReset() or utjson_arenaDestroy(); utjson_destruct()
+ * does not free their memory. Children attached to arena containers should
+ * come from the same arena, heap nodes attached there are not freed by a reset.
+ */
+typedef struct utjson_arena utjson_arena;
+
+/**
+ * @brief Thread-safe pool of strings shared across documents.
+ *
+ * Every distinct string is stored once together with its hash. Member names
+ * taken from a pool are borrowed by the nodes (utjson_INTERNED_NAME), so the
+ * pool has to outlive every document using it.
+ */
+typedef struct utjson_intern utjson_intern;
+
+/**
+ * @brief JSON Pointer (RFC 6901) compiled once for repeated lookups.
+ *
+ * Reference tokens are unescaped, hashed and, where possible, parsed as array
+ * indices up front, see utjson_pointerCompile().
+ */
+typedef struct utjson_pointer utjson_pointer;
+
+/**
+ * @brief JSONPath query compiled into an executable plan, see utjson_pathCompile().
+ *
+ * A plan is read-only during evaluation and can be shared by several threads.
+ */
+typedef struct utjson_path utjson_path;
+
+/**
+ * @brief Growable output buffer used by the serializer.
+ *
+ * A zero-initialized buffer is empty and ready to use. The capacity grows
+ * geometrically, so appending n bytes costs amortized O(n).
+ */
+typedef struct utjson_buffer
+{
+    char *data;       /**< Written bytes, always NUL-terminated once non-empty */
+    size_t length;    /**< Number of written bytes (without the NUL) */
+    size_t allocated; /**< Capacity of data */
+} utjson_buffer;
+
+/**
+ * @brief Index entry of an object member (objects only, never on the values themselves).
+ */
+typedef struct utjson_member
+{
+    size_t position;   /**< Slot of the member in the object's children */
+    UT_hash_handle hh; /**< uthash handle, keyed by the member's name */
+} utjson_member;
+
+/**
+ * @brief Member name compiled once for repeated lookups, see utjson_keyCompile().
+ *
+ * The key refers to name without copying it, so name must outlive the key.
+ */
+typedef struct utjson_key
+{
+    const char *name; /**< Member name */
+    size_t length;    /**< strlen(name) */
+    unsigned hash;    /**< uthash hash of name */
+} utjson_key;
 
 /**
  * @brief JSON structure for representing objects, arrays, and values.
+ *
+ * The payload is a union selected by type, so a scalar costs 64 bytes on
+ * 64-bit targets. Object members are children in insertion order; objects
+ * with more than utjson_OBJECT_INDEX_THRESHOLD members also index them by
+ * name through separate utjson_member entries.
  */
 typedef struct utjson
 {
-    char *name;               /**< Key name (for objects) */
-    UT_hash_handle hh;        /**< uthash handle for fast lookups in objects */
-    struct utjson *parent;    /**< Pointer to parent object */
-    utjson_type type;         /**< Type of the JSON value */
-    double number;            /**< Numeric value (if type == utjson_NUMBER) */
-    char *string;             /**< String value (if type == utjson_STRING) */
-    void *pointer;            /**< Generic pointer storage */
-    char *pointer_type;       /**< String describing the pointer type */
-    uint16_t allocated;       /**< Number of allocated child elements (arrays/objects) */
-    uint16_t used;            /**< Number of used child elements (arrays/objects) */
-    struct utjson **children; /**< Array of child elements (for arrays and objects) */
+    char *name;            /**< Key name (for object members) */
+    struct utjson *parent; /**< Pointer to parent object */
+    utjson_arena *arena;   /**< Arena owning the node memory (NULL for heap nodes) */
+    utjson_type type;      /**< Type of the JSON value */
+    uint8_t flags;         /**< utjson_BORROWED_*, utjson_INTEGER and utjson_UNSIGNED bits */
+    union
+    {
+        struct
+        {
+            char *string; /**< String value (STRING), cached text (NUMBER, BOOL) */
+            union
+            {
+                double number;     /**< Numeric value (NUMBER, BOOL) */
+                int64_t integer;   /**< Integer value (NUMBER with utjson_INTEGER) */
+                uint64_t uinteger; /**< Unsigned value (NUMBER with utjson_INTEGER | utjson_UNSIGNED) */
+            };
+        };
+        struct
+        {
+            void *pointer;      /**< Generic pointer storage (POINTER) */
+            char *pointer_type; /**< String describing the pointer type (POINTER) */
+        };
+        struct
+        {
+            struct utjson **children; /**< Elements (ARRAY) or members in insertion order (OBJECT) */
+            size_t allocated;         /**< Number of allocated child elements */
+            size_t used;              /**< Number of used child elements */
+            utjson_member *members;   /**< Member index by name (OBJECT, NULL while small) */
+        };
+    };
 } utjson;
 
 /**
@@ -85,6 +205,16 @@ utjson *utjson_createBool(bool value);
  * @return Pointer to a new utjson object of type utjson_NUMBER.
  */
 utjson *utjson_createNumber(double value);
+/**
+ * @brief Creates a numeric JSON value holding an exact 64-bit integer.
+ * @param value The integer to store.
+ * @return Pointer to a new utjson object of type utjson_NUMBER with utjson_INTEGER set.
+ */
+utjson *utjson_createInt64(int64_t value);
+/**
+ * @brief Creates a numeric JSON value holding an exact unsigned 64-bit integer.
+ */
+utjson *utjson_createUint64(uint64_t value);
 /**
  * @brief Creates a new string JSON value.
  * @param value Pointer to a string (will be copied).
@@ -107,6 +237,75 @@ utjson *utjson_createObject(void);
  */
 utjson *utjson_createPointer(void *ptr, const char *type);
 
+/**
+ * @brief Creates an arena.
+ * @param block_size Size of regular blocks (0 for utjson_ARENA_BLOCK).
+ * @return Pointer to the arena, or NULL on failure.
+ */
+utjson_arena *utjson_arenaCreate(size_t block_size);
+/**
+ * @brief Allocates uninitialized memory from the arena.
+ * @param arena Pointer to the arena.
+ * @param size Number of bytes.
+ * @return Pointer to the memory, or NULL on failure.
+ */
+void *utjson_arenaAlloc(utjson_arena *arena, size_t size);
+/**
+ * @brief Copies a string of known length into the arena (NUL-terminated).
+ * @param arena Pointer to the arena.
+ * @param source Bytes to copy.
+ * @param length Number of bytes.
+ * @return Pointer to the copy, or NULL on failure.
+ */
+char *utjson_arenaStrndup(utjson_arena *arena, const char *source, size_t length);
+/**
+ * @brief Releases everything allocated from the arena at once.
+ * @param arena Pointer to the arena (stays usable).
+ */
+void utjson_arenaReset(utjson_arena *arena);
+/**
+ * @brief Destroys the arena together with all its documents.
+ * @param arena Pointer to the arena.
+ * @return NULL
+ */
+utjson_arena *utjson_arenaDestroy(utjson_arena *arena);
+
+/**
+ * Arena variants of the constructors (a NULL arena means the heap)
+ */
+utjson *utjson_createNullIn(utjson_arena *arena);
+utjson *utjson_createBoolIn(utjson_arena *arena, bool value);
+utjson *utjson_createNumberIn(utjson_arena *arena, double value);
+utjson *utjson_createInt64In(utjson_arena *arena, int64_t value);
+utjson *utjson_createUint64In(utjson_arena *arena, uint64_t value);
+utjson *utjson_createStringIn(utjson_arena *arena, char *value);
+utjson *utjson_createArrayIn(utjson_arena *arena);
+utjson *utjson_createObjectIn(utjson_arena *arena);
+utjson *utjson_createPointerIn(utjson_arena *arena, void *ptr, const char *type);
+
+/**
+ * @brief Creates an intern pool.
+ * @return Pointer to the pool, or NULL on failure.
+ */
+utjson_intern *utjson_internCreate(void);
+/**
+ * @brief Destroys the pool and all its strings.
+ * @param pool Pointer to the pool.
+ * @return NULL
+ */
+utjson_intern *utjson_internDestroy(utjson_intern *pool);
+/**
+ * @brief Returns the pooled copy of a string, adding it if new.
+ *
+ * Equal strings always give the same pointer. Safe to call from several threads.
+ *
+ * @param pool Pointer to the pool.
+ * @param text Bytes of the string (no NUL needed).
+ * @param length Number of bytes.
+ * @return NUL-terminated copy owned by the pool, or NULL on failure.
+ */
+const char *utjson_internString(utjson_intern *pool, const char *text, size_t length);
+
 /**
  * @brief Retrieves a boolean value from a JSON object.
  * @param object Pointer to a utjson object.
@@ -120,9 +319,28 @@ bool utjson_asBool(utjson *object);
  * @return The numeric value stored in the object.
  */
 double utjson_asNumber(utjson *object);
+/**
+ * @brief Retrieves an integer value from a JSON object.
+ *
+ * Exact for integer numbers; doubles are truncated toward zero.
+ *
+ * @param object Pointer to a utjson object.
+ * @return The value, saturated with errno ERANGE when it does not fit.
+ */
+int64_t utjson_asInt64(utjson *object);
+/**
+ * @brief Retrieves an unsigned integer value from a JSON object.
+ * @param object Pointer to a utjson object.
+ * @return The value, saturated with errno ERANGE when it does not fit (negative values give 0).
+ */
+uint64_t utjson_asUint64(utjson *object);
 
 /**
  * @brief Retrieves a string value from a JSON object.
+ *
+ * Numbers (and booleans) are written in their shortest round-trip form,
+ * the same text utjson_print() produces.
+ *
  * @param object Pointer to a utjson object.
  * @return Pointer to the string stored in the object.
  */
@@ -141,6 +359,19 @@ void *utjson_asPointer(utjson *object, char **pointer_type);
  * @return Pointer to the corresponding JSON value, or NULL if not found.
  */
 utjson *utjson_get(utjson *object, char *name);
+/**
+ * @brief Compiles a member name for utjson_getByKey() and utjson_setByKey().
+ * @param name The key; referenced, not copied.
+ * @return Key with the cached length and hash of name.
+ */
+utjson_key utjson_keyCompile(const char *name);
+/**
+ * @brief Retrieves a value from a JSON object by a compiled key, without hashing the name.
+ * @param object Pointer to the JSON object.
+ * @param key Compiled key.
+ * @return Pointer to the corresponding JSON value, or NULL if not found.
+ */
+utjson *utjson_getByKey(utjson *object, const utjson_key *key);
 
 /**
  * @brief Retrieves a value from a JSON array by index.
@@ -148,7 +379,7 @@ utjson *utjson_get(utjson *object, char *name);
  * @param index The index of the element.
  * @return Pointer to the JSON element at the given index, or NULL if out of bounds.
  */
-utjson *utjson_select(utjson *array, uint16_t index);
+utjson *utjson_select(utjson *array, size_t index);
 
 /**
  * @brief Sets a key-value pair in a JSON object.
@@ -158,12 +389,109 @@ utjson *utjson_select(utjson *array, uint16_t index);
  * @return Pointer to the modified JSON object.
  */
 utjson *utjson_set(utjson *target, char *name, utjson *object);
+/**
+ * @brief Sets a named child whose name is taken from the pool.
+ *
+ * The name is not copied; its pooled hash is reused for the member index.
+ * The pool need not be the one the object's other names come from: names are
+ * matched by content, the shared address only saves the comparison.
+ *
+ * @param target Pointer to the JSON object.
+ * @param pool Intern pool for the name.
+ * @param name Name of the child.
+ * @param object Child to set (NULL for null).
+ * @return Pointer to the child, or NULL on failure.
+ */
+utjson *utjson_setInterned(utjson *target, utjson_intern *pool, const char *name, utjson *object);
+/**
+ * @brief Sets a named child by a compiled key, without hashing the name.
+ * @param target Pointer to the JSON object.
+ * @param key Compiled key; the name is copied into the member.
+ * @param object Child to set (NULL for null).
+ * @return Pointer to the child, or NULL on failure.
+ */
+utjson *utjson_setByKey(utjson *target, const utjson_key *key, utjson *object);
+
+/**
+ * @brief Compiles a JSON Pointer such as "/a/b/3/c" ("" is the whole document).
+ * @param text Pointer text; "~1" stands for '/' and "~0" for '~'.
+ * @return Compiled pointer, or NULL if text is malformed (EINVAL) or on failure.
+ */
+utjson_pointer *utjson_pointerCompile(const char *text);
+/**
+ * @brief Destroys a compiled pointer.
+ * @param pointer Compiled pointer.
+ * @return NULL
+ */
+utjson_pointer *utjson_pointerDestroy(utjson_pointer *pointer);
+/**
+ * @brief Resolves a compiled pointer in one pass, without hashing.
+ * @param root Document to search.
+ * @param pointer Compiled pointer.
+ * @return The value the pointer names, or NULL if there is none.
+ */
+utjson *utjson_pointerGet(utjson *root, const utjson_pointer *pointer);
+/**
+ * @brief Stores a value at the place a compiled pointer names.
+ *
+ * The parent must exist. An object member is set like utjson_set(). An array
+ * element is replaced, and the index one past the end or "-" appends.
+ *
+ * @param root Document to modify.
+ * @param pointer Compiled pointer, not "".
+ * @param object Value to store (NULL for null); stays with the caller on failure.
+ * @return Pointer to the stored value, or NULL on failure.
+ */
+utjson *utjson_pointerSet(utjson *root, const utjson_pointer *pointer, utjson *object);
+
+/**
+ * @brief Compiles a JSONPath query.
+ *
+ * Supported: $ (root), .name, ['name'], [index] (negative from the end),
+ * [start:end:step], * and .., unions like [0,'a'], and filters like
+ * [?(@.price > 10 && @.tag)] or [?@.kind == 'x'], with ==, !=, <, <=, >, >=,
+ * &&, ||, !, parentheses, relative (@) and absolute ($) queries, and
+ * string, number, true, false and null literals.
+ *
+ * @param query Query text.
+ * @return Compiled query, or NULL if the query is malformed (EINVAL) or on failure.
+ */
+utjson_path *utjson_pathCompile(const char *query);
+/**
+ * @brief Destroys a compiled query.
+ * @param path Compiled query.
+ * @return NULL
+ */
+utjson_path *utjson_pathDestroy(utjson_path *path);
+/**
+ * @brief Receives a match of utjson_pathEach(); the node stays owned by the document.
+ * @return true to continue, false to stop the query.
+ */
+typedef bool (*utjson_path_callback)(void *user, utjson *match);
+/**
+ * @brief Runs a compiled query and passes every match to the callback, in document order.
+ * @param root Document to search.
+ * @param path Compiled query.
+ * @param callback Receives the matches.
+ * @param user Passed to the callback.
+ * @return true, or false if the callback stopped the query (ECANCELED) or on invalid input.
+ */
+bool utjson_pathEach(utjson *root, const utjson_path *path, utjson_path_callback callback, void *user);
+/**
+ * @brief Runs a compiled query and collects its matches.
+ * @param root Document to search.
+ * @param path Compiled query.
+ * @param count Receives the number of matches (may be NULL).
+ * @return NULL-terminated array of the matching nodes (owned by the document), to be freed with free().
+ */
+utjson **utjson_pathSelect(utjson *root, const utjson_path *path, size_t *count);
 /**
  * Helpers for object
  */
 utjson *utjson_setNull(utjson *target, char *name);
 utjson *utjson_setBool(utjson *target, char *name, bool value);
 utjson *utjson_setNumber(utjson *target, char *name, double value);
+utjson *utjson_setInt64(utjson *target, char *name, int64_t value);
 utjson *utjson_setString(utjson *target, char *name, char *value);
 utjson *utjson_setArray(utjson *target, char *name);
 utjson *utjson_setObject(utjson *target, char *name);
@@ -179,19 +507,340 @@ utjson *utjson_setObject(utjson *target, char *name);
  * @return Pointer to the added JSON object, or NULL on failure.
  */
 utjson *utjson_add(utjson *target, utjson *object);
+/**
+ * @brief Preallocates room for elements in a JSON array.
+ *
+ * Appending up to capacity elements afterwards never reallocates.
+ *
+ * @param array Pointer to the JSON array.
+ * @param capacity Total number of elements to make room for.
+ * @return Pointer to the array, or NULL on failure.
+ */
+utjson *utjson_arrayReserve(utjson *array, size_t capacity);
 /**
  * Helpers for array
  */
 utjson *utjson_addNull(utjson *target);
 utjson *utjson_addBool(utjson *target, bool value);
 utjson *utjson_addNumber(utjson *target, double value);
+utjson *utjson_addInt64(utjson *target, int64_t value);
 utjson *utjson_addString(utjson *target, char *value);
 utjson *utjson_addArray(utjson *target);
 utjson *utjson_addObject(utjson *target);
 
 utjson *utjson_parse(char *source);
+
+/**
+ * @brief Parses a JSON string with explicit parser options.
+ *
+ * The indexed engine first locates every structural character, quote and
+ * literal with AVX2/SSE2 (picked at runtime, scalar fallback elsewhere),
+ * then builds the tree from that index. utjson_parse() selects it on its
+ * own for inputs of utjson_PARSE_INDEX_THRESHOLD bytes and more.
+ *
+ * @param source JSON string to parse.
+ * @param flags Combination of utjson_parse_flags.
+ * @return Pointer to the root value, or NULL on failure.
+ */
+utjson *utjson_parseWith(char *source, unsigned flags);
+
+/**
+ * @brief Parses a mutable buffer without copying strings or keys.
+ *
+ * String values and keys are NUL-terminated in place and point into the
+ * buffer, which must outlive the returned tree. The buffer does not need a
+ * trailing NUL.
+ *
+ * @param buffer JSON text, modified by the parser.
+ * @param length Number of bytes in buffer.
+ * @return Pointer to the root value, or NULL on failure.
+ */
+utjson *utjson_parseInPlace(char *buffer, size_t length);
+
+/**
+ * @brief Parses a JSON string into a document placed in the arena.
+ * @param arena Pointer to the arena (NULL for the heap).
+ * @param source JSON string to parse.
+ * @return Pointer to the root value, or NULL on failure.
+ */
+utjson *utjson_parseInArena(utjson_arena *arena, char *source);
+
+/**
+ * @brief Parses length bytes of JSON, taking member names from an intern pool.
+ *
+ * Names are borrowed from the pool instead of allocated per member, and their
+ * pooled hashes are reused by the member index. With utjson_PARSE_INTERN_VALUES
+ * string values of up to utjson_INTERN_VALUE_MAX bytes are pooled as well.
+ *
+ * @param pool Intern pool, must outlive the document.
+ * @param source JSON text (no NUL needed; modified with utjson_PARSE_IN_PLACE).
+ * @param length Number of bytes in source.
+ * @param flags Combination of utjson_parse_flags.
+ * @return Pointer to the root value, or NULL on failure.
+ */
+utjson *utjson_parseInterned(utjson_intern *pool, char *source, size_t length, unsigned flags);
+
+/**
+ * @brief Parses only the branches of a document that a set of JSON Pointers name.
+ *
+ * Values a pointer names are built whole, containers on the way keep only the
+ * members and elements leading to them, and everything else is stepped over by
+ * a scanner that builds nothing but checks brackets, commas, strings and
+ * scalars as the parsers do. Only whitespace may follow the document. Each
+ * pointer resolves in the result as it would in the full document: skipped
+ * array elements before a kept one become null. Branches that lead nowhere
+ * are left out.
+ *
+ * @param source JSON text (no NUL needed; modified with utjson_PARSE_IN_PLACE).
+ * @param length Number of bytes in source.
+ * @param pointers Compiled pointers of the values to keep ("" keeps everything).
+ * @param count Number of pointers.
+ * @param flags utjson_PARSE_IN_PLACE, utjson_PARSE_INTEGERS and utjson_PARSE_VALIDATE_UTF8 apply.
+ * @return Root container of the projection, or NULL on failure.
+ */
+utjson *utjson_parseProjected(char *source, size_t length, const utjson_pointer *const *pointers, size_t count,
+                              unsigned flags);
+
+/**
+ * @brief Parses a file through a memory mapping, without reading it into a string first.
+ *
+ * The file needs no trailing NUL. The mapping is released before returning,
+ * so utjson_PARSE_IN_PLACE is ignored here; see utjson_parseFileIn().
+ *
+ * @param path File to parse.
+ * @param flags Combination of utjson_parse_flags.
+ * @return Pointer to the root value, or NULL on failure (errno from open/mmap, or EINVAL).
+ */
+utjson *utjson_parseFile(const char *path, unsigned flags);
+/**
+ * @brief Parses a file into a document placed in the arena.
+ *
+ * With utjson_PARSE_IN_PLACE strings and keys borrow a private copy-on-write
+ * mapping of the file, which stays alive until the arena is reset or destroyed.
+ * Only the pages holding a string end are copied; the file itself is never changed.
+ *
+ * @param arena Pointer to the arena (NULL for the heap, which disables utjson_PARSE_IN_PLACE).
+ * @param path File to parse.
+ * @param flags Combination of utjson_parse_flags.
+ * @return Pointer to the root value, or NULL on failure.
+ */
+utjson *utjson_parseFileIn(utjson_arena *arena, const char *path, unsigned flags);
+
+/**
+ * @brief Writes a tree as a binary image that utjson_mapBinary() loads without parsing.
+ *
+ * The image holds the nodes, strings, child tables and member indexes in
+ * their in-memory layout, with pointers set for an address picked from path.
+ * The file is replaced atomically, so processes mapping the old image keep it.
+ * POINTER values keep their type only. Images are tied to the ABI of the
+ * library that wrote them.
+ *
+ * @param object Root of the tree.
+ * @param path File to write.
+ * @return true on success, false with errno set on failure.
+ */
+bool utjson_saveBinary(const utjson *object, const char *path);
+/**
+ * @brief Maps an image written by utjson_saveBinary() as a read-only tree.
+ *
+ * Nothing is allocated or parsed: when the image's preferred address is free,
+ * the file is mapped there shared and read-only, so its pages stay in the page
+ * cache across processes and are touched only when read. Elsewhere a private
+ * mapping is relocated first. The tree works with the accessors (utjson_get,
+ * utjson_select, utjson_asNumber, utjson_asString, the pointer and path
+ * queries, the printer); it must not be modified, utjson_clone() gives a
+ * mutable copy. utjson_destruct() on the root releases the mapping and does
+ * nothing on the other nodes.
+ *
+ * @param path Image to map.
+ * @return Pointer to the root value, or NULL on failure (errno from open/mmap, or EINVAL for a foreign file).
+ */
+utjson *utjson_mapBinary(const char *path);
+
+/**
+ * @brief Resumable push parser for documents arriving in chunks.
+ */
+typedef struct utjson_parser utjson_parser;
+
+/**
+ * @brief Creates a push parser.
+ * @param flags utjson_PARSE_INTEGERS and utjson_PARSE_VALIDATE_UTF8 apply; chunks are always copied, so the engine flags do not.
+ * @return Pointer to the parser, or NULL on failure.
+ */
+utjson_parser *utjson_parserNew(unsigned flags);
+/**
+ * @brief Creates a push parser whose document is placed in the arena.
+ */
+utjson_parser *utjson_parserNewIn(utjson_arena *arena, unsigned flags);
+/**
+ * @brief Consumes the next chunk of the document.
+ *
+ * Chunks may split the input anywhere, including inside strings, numbers
+ * and literals. The tree is built as the chunks arrive.
+ *
+ * @param parser Pointer to the parser.
+ * @param chunk Next bytes of the input (no NUL needed).
+ * @param length Number of bytes in chunk.
+ * @return false once the input is known to be malformed.
+ */
+bool utjson_parserFeed(utjson_parser *parser, const char *chunk, size_t length);
+/**
+ * @brief Ends the input, releases the parser and returns the document.
+ * @param parser Pointer to the parser.
+ * @return Pointer to the root value, or NULL if the input was malformed or incomplete.
+ */
+utjson *utjson_parserFinish(utjson_parser *parser);
+
+/**
+ * @brief Receives one record of utjson_parseLines().
+ * @param user Context given to utjson_parseLines().
+ * @param offset Byte offset of the record in the input.
+ * @param document Parsed record, owned by the callee; NULL if the record is malformed.
+ * @return false to stop parsing.
+ */
+typedef bool (*utjson_line_callback)(void *user, size_t offset, utjson *document);
+
+/**
+ * @brief Parses newline-delimited JSON (JSON Lines) on a pool of threads.
+ *
+ * The input is cut into batches of about utjson_LINES_BATCH bytes at line
+ * boundaries; the workers parse whole batches while the calling thread runs
+ * the callback, so the callback needs no locking. Records arrive in input
+ * order unless flags has utjson_PARSE_UNORDERED. Blank lines are skipped.
+ *
+ * @param source Input (no NUL needed, not modified).
+ * @param length Number of bytes in source.
+ * @param workers Number of parsing threads, 0 for one per online CPU.
+ * @param flags Combination of utjson_parse_flags (utjson_PARSE_IN_PLACE is ignored).
+ * @param callback Receives every record.
+ * @param user Passed to the callback.
+ * @return true if all records were delivered; false with errno ECANCELED if the callback stopped, or ENOMEM.
+ */
+bool utjson_parseLines(const char *source, size_t length, size_t workers, unsigned flags,
+                       utjson_line_callback callback, void *user);
+/**
+ * @brief utjson_parseLines() over a memory-mapped file.
+ */
+bool utjson_parseLinesFile(const char *path, size_t workers, unsigned flags, utjson_line_callback callback, void *user);
+
+/**
+ * @brief What an event callback asks the parser to do next.
+ */
+typedef enum
+{
+    utjson_SAX_CONTINUE = 0, /**< Go on with the next event */
+    utjson_SAX_ABORT,        /**< Stop parsing, utjson_parseEvents() fails with ECANCELED */
+    utjson_SAX_SKIP,         /**< From start_*: skip the container; from key: skip the member value */
+} utjson_sax_action;
+
+/**
+ * @brief Event callbacks; any of them may be NULL.
+ *
+ * Strings and keys are passed as raw spans of the input (not NUL-terminated,
+ * escapes left as is) and are valid only during the call.
+ */
+typedef struct utjson_sax
+{
+    utjson_sax_action (*start_object)(void *user);
+    utjson_sax_action (*end_object)(void *user);
+    utjson_sax_action (*start_array)(void *user);
+    utjson_sax_action (*end_array)(void *user);
+    utjson_sax_action (*key)(void *user, const char *name, size_t length);
+    utjson_sax_action (*string)(void *user, const char *value, size_t length);
+    utjson_sax_action (*number)(void *user, double value);
+    utjson_sax_action (*boolean)(void *user, bool value);
+    utjson_sax_action (*null)(void *user);
+} utjson_sax;
+
+/**
+ * @brief Parses a JSON text into callbacks without building a tree.
+ *
+ * Uses the structural index and allocates nothing per event. A skipped
+ * container produces no events at all, not even its end, but is checked as
+ * strictly as the rest of the document.
+ *
+ * @param source JSON text (no NUL needed).
+ * @param length Number of bytes in source.
+ * @param sax Callbacks.
+ * @param user Passed to every callback.
+ * @return true on success; false with errno EINVAL on malformed input or ECANCELED on abort.
+ */
+bool utjson_parseEvents(const char *source, size_t length, const utjson_sax *sax, void *user);
+
 char *utjson_print(utjson *object, bool readable);
 
+/**
+ * @brief Serializes a JSON value into a new string and reports its length.
+ * @param object Pointer to the JSON value.
+ * @param readable Adds spaces after separators if true.
+ * @param length Receives the length of the result (may be NULL).
+ * @return Dynamically allocated JSON string (must be freed), or NULL on failure.
+ */
+char *utjson_printLen(utjson *object, bool readable, size_t *length);
+
+/**
+ * @brief Appends the serialized JSON value to a buffer.
+ * @param buffer Output buffer (zero-initialized or reused).
+ * @param object Pointer to the JSON value.
+ * @param readable Adds spaces after separators if true.
+ * @return true on success, false on allocation failure.
+ */
+bool utjson_printTo(utjson_buffer *buffer, utjson *object, bool readable);
+
+/**
+ * @brief Encodes a JSON value as CBOR (RFC 8949) into a new buffer.
+ *
+ * Integers keep their exact 64-bit value, other numbers take the shortest of
+ * half, single and double precision that holds them exactly. Objects become
+ * maps with text keys, in member order. Strings and names that are not UTF-8,
+ * which the parsers keep unless asked to validate, are written as byte
+ * strings, so the encoding stays valid; utjson_fromCBOR() reads them back as
+ * base64url text.
+ *
+ * @param object Pointer to the JSON value.
+ * @param length Receives the length of the result (may be NULL).
+ * @return Dynamically allocated encoding (must be freed), or NULL on failure.
+ */
+uint8_t *utjson_toCBOR(const utjson *object, size_t *length);
+/**
+ * @brief Appends the CBOR encoding of a JSON value to a buffer.
+ * @return true on success, false on allocation failure.
+ */
+bool utjson_toCBORTo(utjson_buffer *buffer, const utjson *object);
+/**
+ * @brief Decodes one CBOR data item into a tree.
+ *
+ * Nesting is tracked on an explicit stack, so deep input costs no C stack.
+ * Indefinite-length items are accepted and tags are skipped. Unsigned and
+ * negative integers become utjson_INTEGER numbers (doubles past int64_t), byte
+ * strings become their base64url text without padding (RFC 8949 section 6.1),
+ * undefined becomes null. Map keys must be strings. Text strings must be UTF-8
+ * without NUL bytes, which a NUL-terminated string cannot hold.
+ *
+ * @param data Encoded item.
+ * @param length Number of bytes in data; trailing bytes are an error.
+ * @return Pointer to the root value, or NULL with errno EINVAL (malformed) or ENOMEM.
+ */
+utjson *utjson_fromCBOR(const uint8_t *data, size_t length);
+/**
+ * @brief Decodes one CBOR data item into a tree placed in the arena.
+ */
+utjson *utjson_fromCBORIn(utjson_arena *arena, const uint8_t *data, size_t length);
+
+/**
+ * @brief Ensures the buffer can take size more bytes without reallocation.
+ * @param buffer Output buffer.
+ * @param size Number of bytes to reserve.
+ * @return true on success, false on allocation failure.
+ */
+bool utjson_bufferReserve(utjson_buffer *buffer, size_t size);
+
+/**
+ * @brief Releases the buffer storage and resets it to empty.
+ * @param buffer Output buffer.
+ */
+void utjson_bufferFree(utjson_buffer *buffer);
+
 /**
  * @brief Detaches an object from its parent.
  * @param object Pointer to the JSON object to detach.
@@ -208,10 +857,10 @@ utjson *utjson_clone(const utjson *object);
 
 #define utjson_arrayFor(array, item, index) \
     if (utjson_IS(ARRAY, array))            \
-        for (uint16_t index = 0; index < array->used && (item = array[index], 1); index++)
+        for (size_t index = 0; index < array->used && (item = array->children[index], 1); index++)
 
 #define utjson_objectForEach(object, item, tmp) \
     if (utjson_IS(OBJECT, object))              \
-    HASH_ITER(hh, *(object->children), item, tmp)
+        for (size_t tmp = 0; tmp < object->used && (item = object->children[tmp], 1); tmp++)
 
 #endif // UTJSON_H
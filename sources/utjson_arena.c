@@ -0,0 +1,218 @@
+#include "utjson_internal.h"
+#include <errno.h>
+
+/**
+ * Strictest alignment any node, string or table needs
+ */
+typedef union
+{
+    long double number;
+    void *pointer;
+    long long integer;
+} utjson_arena_align;
+
+/**
+ * One contiguous chunk of arena memory
+ */
+typedef struct utjson_arena_block
+{
+    struct utjson_arena_block *next; /**< Previously filled block */
+    size_t size;                     /**< Capacity of data */
+    size_t used;                     /**< Bytes handed out from data */
+    utjson_arena_align data[];       /**< Storage */
+} utjson_arena_block;
+
+/**
+ * Release callback registered with utjson_arenaDefer()
+ */
+typedef struct utjson_arena_cleanup
+{
+    struct utjson_arena_cleanup *next; /**< Earlier registration */
+    void (*release)(void *data);       /**< Called by the next reset */
+    void *data;                        /**< Argument of release */
+} utjson_arena_cleanup;
+
+/**
+ * Region allocator: everything is released at once by a reset
+ */
+struct utjson_arena
+{
+    utjson_arena_block *blocks;     /**< Current block, older blocks follow */
+    size_t block_size;              /**< Capacity of a regular block */
+    utjson_arena_cleanup *cleanups; /**< Latest registration first */
+};
+
+#define ARENA_ALIGN (sizeof(utjson_arena_align))
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+static utjson_arena_block *block_new(size_t size)
+{
+    utjson_arena_block *block = malloc(sizeof(utjson_arena_block) + size);
+    if (block)
+    {
+        block->next = NULL;
+        block->size = size;
+        block->used = 0;
+    }
+    return block;
+}
+
+/**
+ * Creates an arena
+ *
+ * @param block_size
+ * @return utjson_arena*
+ */
+utjson_arena *utjson_arenaCreate(size_t block_size)
+{
+    utjson_arena *arena = calloc(1, sizeof(utjson_arena));
+    if (!arena)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    arena->block_size = ARENA_ROUND(block_size ? block_size : utjson_ARENA_BLOCK);
+    arena->blocks = block_new(arena->block_size);
+    if (!arena->blocks)
+    {
+        free(arena);
+        errno = ENOMEM;
+        return NULL;
+    }
+    return arena;
+}
+
+/**
+ * Allocates uninitialized, suitably aligned memory from the arena
+ *
+ * @param arena
+ * @param size
+ * @return void*
+ */
+void *utjson_arenaAlloc(utjson_arena *arena, size_t size)
+{
+    if (!arena)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    size = ARENA_ROUND(size ? size : 1);
+
+    utjson_arena_block *block = arena->blocks;
+    if (block->size - block->used >= size)
+    {
+        void *result = (char *)block->data + block->used;
+        block->used += size;
+        return result;
+    }
+
+    if (size > arena->block_size / 4)
+    {
+        // oversized request: private block behind the current one, which keeps its free space
+        utjson_arena_block *large = block_new(size);
+        if (!large)
+        {
+            errno = ENOMEM;
+            return NULL;
+        }
+        large->used = size;
+        large->next = block->next;
+        block->next = large;
+        return large->data;
+    }
+
+    utjson_arena_block *fresh = block_new(arena->block_size);
+    if (!fresh)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    fresh->next = block;
+    fresh->used = size;
+    arena->blocks = fresh;
+    return fresh->data;
+}
+
+/**
+ * Copies a string of known length into the arena
+ *
+ * @param arena
+ * @param source
+ * @param length
+ * @return char*
+ */
+char *utjson_arenaStrndup(utjson_arena *arena, const char *source, size_t length)
+{
+    char *copy = utjson_arenaAlloc(arena, length + 1);
+    if (copy)
+    {
+        memcpy(copy, source, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+/**
+ * Runs release(data) on the next reset or destroy of the arena
+ *
+ * @param arena
+ * @param release
+ * @param data
+ * @return true | false
+ */
+bool utjson_arenaDefer(utjson_arena *arena, void (*release)(void *data), void *data)
+{
+    // the record lives in the arena itself and goes away with the reset that runs it
+    utjson_arena_cleanup *cleanup = utjson_arenaAlloc(arena, sizeof(utjson_arena_cleanup));
+    if (!cleanup)
+        return false;
+    cleanup->release = release;
+    cleanup->data = data;
+    cleanup->next = arena->cleanups;
+    arena->cleanups = cleanup;
+    return true;
+}
+
+/**
+ * Releases everything allocated from the arena, keeping one block for reuse
+ *
+ * @param arena
+ */
+void utjson_arenaReset(utjson_arena *arena)
+{
+    if (!arena)
+        return;
+    for (utjson_arena_cleanup *cleanup = arena->cleanups; cleanup; cleanup = cleanup->next)
+    {
+        cleanup->release(cleanup->data);
+    }
+    arena->cleanups = NULL;
+    // the current block is always a regular one (oversized blocks sit behind it), keep it
+    utjson_arena_block *keep = arena->blocks;
+    utjson_arena_block *block = keep->next;
+    while (block)
+    {
+        utjson_arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    keep->next = NULL;
+    keep->used = 0;
+}
+
+/**
+ * Destroys the arena and everything allocated from it
+ *
+ * @param arena
+ * @return utjson_arena*
+ */
+utjson_arena *utjson_arenaDestroy(utjson_arena *arena)
+{
+    if (arena)
+    {
+        utjson_arenaReset(arena);
+        free(arena->blocks);
+        free(arena);
+    }
+    return NULL;
+}
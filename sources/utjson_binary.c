@@ -0,0 +1,450 @@
+#include "utjson_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BINARY_MAGIC "UTJSONB1"
+#define BINARY_HEADER 64                       /**< Bytes before the root node */
+#define BINARY_BASE_FIRST 0x100000000000ULL    /**< Lowest preferred mapping address */
+#define BINARY_BASE_SLOTS 4096                 /**< Preferred addresses, 4 GiB apart */
+#define BINARY_BASE_STRIDE 0x100000000ULL
+
+/**
+ * First bytes of an image written by utjson_saveBinary()
+ *
+ * The image holds the nodes in their in-memory layout with every pointer set
+ * as if the file were mapped at base. Where that address is taken, the
+ * pointer slots marked in the relocation bitmap (one bit per 8-byte word of
+ * the image) are shifted instead.
+ */
+typedef struct
+{
+    char magic[8];         /**< BINARY_MAGIC */
+    uint16_t byte_order;   /**< 0x0102 as written by this machine */
+    uint8_t pointer_size;  /**< sizeof(void *) */
+    uint8_t reserved;      /**< Zero */
+    uint32_t node_size;    /**< sizeof(utjson) */
+    uint32_t member_size;  /**< sizeof(utjson_member) */
+    uint32_t reserved2;    /**< Zero */
+    uint64_t base;         /**< Address the pointers are set for */
+    uint64_t size;         /**< File size */
+    uint64_t relocations;  /**< Offset of the relocation bitmap, i.e. size of the image proper */
+    uint64_t count;        /**< Bytes of the relocation bitmap */
+} binary_header;
+
+_Static_assert(sizeof(binary_header) <= BINARY_HEADER, "binary header overflows the root offset");
+
+/**
+ * Image under construction; offsets, since the buffer moves as it grows
+ */
+typedef struct
+{
+    utjson_buffer image;       /**< Bytes of the file */
+    utjson_buffer relocations; /**< Bitmap of the words holding a pointer */
+    uint64_t base;             /**< Preferred address */
+} binary_writer;
+
+static uint64_t binary_base(const char *path)
+{
+    // FNV-1a, so that images of different files rarely ask for the same address
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char *c = path; *c; c++)
+    {
+        hash = (hash ^ (uint8_t)*c) * 0x100000001b3ULL;
+    }
+    return BINARY_BASE_FIRST + (hash % BINARY_BASE_SLOTS) * BINARY_BASE_STRIDE;
+}
+
+// appends size zero bytes aligned to 8, returns their offset or SIZE_MAX
+static size_t binary_reserve(binary_writer *writer, size_t size)
+{
+    size_t padding = (8 - writer->image.length % 8) % 8;
+    if (!utjson_bufferReserve(&writer->image, padding + size))
+        return SIZE_MAX;
+    size_t at = writer->image.length + padding;
+    memset(writer->image.data + writer->image.length, 0, padding + size);
+    writer->image.length = at + size;
+    return at;
+}
+
+static size_t binary_string(binary_writer *writer, const char *text)
+{
+    size_t length = strlen(text) + 1;
+    if (!utjson_bufferReserve(&writer->image, length))
+        return SIZE_MAX;
+    size_t at = writer->image.length;
+    memcpy(writer->image.data + at, text, length);
+    writer->image.length += length;
+    return at;
+}
+
+// sets bit word of the bitmap, growing it with zeros
+static bool binary_mark(utjson_buffer *bitmap, size_t word)
+{
+    size_t byte = word / 8;
+    if (byte >= bitmap->length)
+    {
+        if (!utjson_bufferReserve(bitmap, byte + 1 - bitmap->length))
+            return false;
+        memset(bitmap->data + bitmap->length, 0, byte + 1 - bitmap->length);
+        bitmap->length = byte + 1;
+    }
+    bitmap->data[byte] |= (char)(1 << (word % 8));
+    return true;
+}
+
+// points the slot at offset slot to the byte at offset target
+static bool binary_link(binary_writer *writer, size_t slot, size_t target)
+{
+    uint64_t address = writer->base + target;
+    uintptr_t pointer = (uintptr_t)address;
+    memcpy(writer->image.data + slot, &pointer, sizeof(pointer));
+    return binary_mark(&writer->relocations, slot / 8);
+}
+
+/**
+ * Lays out the uthash index of an object as HASH_ADD would leave it
+ *
+ * Only what HASH_FIND reads has to be right: the table, the bucket chains and
+ * the key, length and hash of every handle.
+ */
+static bool binary_index(binary_writer *writer, size_t object_at, const utjson *object, const size_t *names)
+{
+    size_t count = object->used;
+    unsigned buckets = HASH_INITIAL_NUM_BUCKETS, log2 = HASH_INITIAL_NUM_BUCKETS_LOG2;
+    while (buckets < count)
+    {
+        buckets *= 2;
+        log2++;
+    }
+
+    size_t table_at = binary_reserve(writer, sizeof(UT_hash_table));
+    size_t buckets_at = binary_reserve(writer, buckets * sizeof(UT_hash_bucket));
+    size_t members_at = binary_reserve(writer, count * sizeof(utjson_member));
+    if (table_at == SIZE_MAX || buckets_at == SIZE_MAX || members_at == SIZE_MAX)
+        return false;
+
+    UT_hash_table table = {
+        .num_buckets = buckets,
+        .log2_num_buckets = log2,
+        .num_items = (unsigned)count,
+        .hho = offsetof(utjson_member, hh),
+        .signature = HASH_SIGNATURE,
+    };
+    memcpy(writer->image.data + table_at, &table, sizeof(table));
+    bool linked = binary_link(writer, table_at + offsetof(UT_hash_table, buckets), buckets_at) &&
+                  binary_link(writer, table_at + offsetof(UT_hash_table, tail),
+                              members_at + (count - 1) * sizeof(utjson_member) + offsetof(utjson_member, hh));
+
+    // every member is pushed onto the front of its bucket chain, as HASH_ADD does
+    size_t *heads = malloc(buckets * sizeof(size_t));
+    if (!heads)
+    {
+        errno = ENOMEM;
+        return false;
+    }
+    memset(heads, 0xFF, buckets * sizeof(size_t));
+    for (size_t i = 0; linked && i < count; i++)
+    {
+        size_t member_at = members_at + i * sizeof(utjson_member);
+        size_t handle_at = member_at + offsetof(utjson_member, hh);
+        const char *name = object->children[i]->name ? object->children[i]->name : "";
+        utjson_member member = {.position = i};
+        member.hh.keylen = (unsigned)strlen(name);
+        HASH_VALUE(name, member.hh.keylen, member.hh.hashv);
+        memcpy(writer->image.data + member_at, &member, sizeof(member));
+
+        size_t bucket = member.hh.hashv & (buckets - 1);
+        linked = binary_link(writer, handle_at + offsetof(UT_hash_handle, tbl), table_at) &&
+                 binary_link(writer, handle_at + offsetof(UT_hash_handle, key), names[i]) &&
+                 (!i || binary_link(writer, handle_at + offsetof(UT_hash_handle, prev), member_at - sizeof(member))) &&
+                 (i + 1 == count ||
+                  binary_link(writer, handle_at + offsetof(UT_hash_handle, next), member_at + sizeof(member))) &&
+                 (heads[bucket] == SIZE_MAX ||
+                  (binary_link(writer, handle_at + offsetof(UT_hash_handle, hh_next), heads[bucket]) &&
+                   binary_link(writer, heads[bucket] + offsetof(UT_hash_handle, hh_prev), handle_at)));
+        heads[bucket] = handle_at;
+
+        UT_hash_bucket *slot = (UT_hash_bucket *)(writer->image.data + buckets_at) + bucket;
+        slot->count++;
+    }
+    for (size_t b = 0; linked && b < buckets; b++)
+    {
+        linked = heads[b] == SIZE_MAX ||
+                 binary_link(writer, buckets_at + b * sizeof(UT_hash_bucket) + offsetof(UT_hash_bucket, hh_head),
+                             heads[b]);
+    }
+    free(heads);
+    return linked && binary_link(writer, object_at + offsetof(utjson, members), members_at);
+}
+
+/**
+ * Writes object into the node slot at offset at, then its strings and children
+ */
+static bool binary_node(binary_writer *writer, size_t at, const utjson *object, size_t parent_at, size_t name_at)
+{
+    utjson node = {
+        .type = object->type,
+        .flags = (object->flags & (utjson_INTEGER | utjson_UNSIGNED)) | utjson_BORROWED_STRING |
+                 utjson_BORROWED_NAME | utjson_MAPPED,
+    };
+    // strings go right behind their node; BOOL and NUMBER keep the text utjson_asString() would cache
+    char number[utjson_NUMBER_TEXT];
+    const char *text = NULL;
+    size_t text_slot = offsetof(utjson, string);
+    switch (object->type)
+    {
+    case utjson_BOOL:
+    case utjson_NUMBER:
+        utjson_nodeFormat(object, number);
+        node.uinteger = object->uinteger;
+        text = number;
+        break;
+    case utjson_STRING:
+        text = object->string;
+        break;
+    case utjson_POINTER:
+        // addresses do not outlive the process, only the type is kept
+        text = object->pointer_type;
+        text_slot = offsetof(utjson, pointer_type);
+        break;
+    case utjson_ARRAY:
+    case utjson_OBJECT:
+        node.allocated = node.used = object->used;
+        break;
+    default:
+        break;
+    }
+    memcpy(writer->image.data + at, &node, sizeof(node));
+
+    if (text)
+    {
+        size_t text_at = binary_string(writer, text);
+        if (text_at == SIZE_MAX || !binary_link(writer, at + text_slot, text_at))
+            return false;
+    }
+    if (parent_at != SIZE_MAX && !binary_link(writer, at + offsetof(utjson, parent), parent_at))
+        return false;
+    if (name_at != SIZE_MAX && !binary_link(writer, at + offsetof(utjson, name), name_at))
+        return false;
+    if (object->type != utjson_ARRAY && object->type != utjson_OBJECT)
+        return true;
+    if (!object->used)
+        return true;
+
+    size_t count = object->used;
+    size_t children_at = binary_reserve(writer, count * sizeof(utjson *));
+    size_t nodes_at = binary_reserve(writer, count * sizeof(utjson));
+    size_t *names = utjson_IS(OBJECT, object) ? malloc(count * sizeof(size_t)) : NULL;
+    bool written = children_at != SIZE_MAX && nodes_at != SIZE_MAX && (names || !utjson_IS(OBJECT, object)) &&
+                   binary_link(writer, at + offsetof(utjson, children), children_at);
+    // siblings are laid out next to each other, so a scan of a container stays on few pages
+    for (size_t i = 0; written && i < count; i++)
+    {
+        size_t child_at = nodes_at + i * sizeof(utjson);
+        const utjson *child = object->children[i];
+        size_t name_at = SIZE_MAX;
+        if (names)
+        {
+            name_at = names[i] = binary_string(writer, child->name ? child->name : "");
+        }
+        written = (!names || name_at != SIZE_MAX) && binary_link(writer, children_at + i * sizeof(utjson *), child_at) &&
+                  binary_node(writer, child_at, child, at, name_at);
+    }
+    if (written && names && count > utjson_OBJECT_INDEX_THRESHOLD)
+    {
+        written = binary_index(writer, at, object, names);
+    }
+    free(names);
+    return written;
+}
+
+static bool binary_write(const char *path, const binary_writer *writer)
+{
+    // a new file under a temporary name, so processes mapping the old one keep it intact
+    size_t length = strlen(path);
+    char *temporary = malloc(length + 8);
+    if (!temporary)
+    {
+        errno = ENOMEM;
+        return false;
+    }
+    snprintf(temporary, length + 8, "%s.XXXXXX", path);
+    int fd = mkstemp(temporary);
+    if (fd < 0)
+    {
+        free(temporary);
+        return false;
+    }
+
+    bool written = true;
+    const utjson_buffer *parts[] = {&writer->image, &writer->relocations};
+    for (size_t p = 0; written && p < 2; p++)
+    {
+        for (size_t done = 0; written && done < parts[p]->length;)
+        {
+            ssize_t put = write(fd, parts[p]->data + done, parts[p]->length - done);
+            if (put < 0 && errno == EINTR)
+                continue;
+            written = put > 0;
+            done += written ? (size_t)put : 0;
+        }
+    }
+    written = written && fchmod(fd, 0644) == 0;
+    written = close(fd) == 0 && written;
+    written = written && rename(temporary, path) == 0;
+    if (!written)
+    {
+        int error = errno;
+        unlink(temporary);
+        errno = error;
+    }
+    free(temporary);
+    return written;
+}
+
+/**
+ * Writes the tree as a relocatable image for utjson_mapBinary()
+ *
+ * @param object
+ * @param path
+ * @return true | false
+ */
+bool utjson_saveBinary(const utjson *object, const char *path)
+{
+    if (!object || !path)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    binary_writer writer = {.base = binary_base(path)};
+    bool built = binary_reserve(&writer, BINARY_HEADER) == 0 &&
+                 binary_reserve(&writer, sizeof(utjson)) == BINARY_HEADER &&
+                 binary_node(&writer, BINARY_HEADER, object, SIZE_MAX, SIZE_MAX) && binary_reserve(&writer, 0) != SIZE_MAX;
+    if (built)
+    {
+        binary_header header = {
+            .byte_order = 0x0102,
+            .pointer_size = sizeof(void *),
+            .node_size = sizeof(utjson),
+            .member_size = sizeof(utjson_member),
+            .base = writer.base,
+            .size = writer.image.length + writer.relocations.length,
+            .relocations = writer.image.length,
+            .count = writer.relocations.length,
+        };
+        memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+        memcpy(writer.image.data, &header, sizeof(header));
+        built = binary_write(path, &writer);
+    }
+    utjson_bufferFree(&writer.image);
+    utjson_bufferFree(&writer.relocations);
+    return built;
+}
+
+static bool binary_compatible(const binary_header *header, size_t size)
+{
+    return memcmp(header->magic, BINARY_MAGIC, sizeof(header->magic)) == 0 && header->byte_order == 0x0102 &&
+           header->pointer_size == sizeof(void *) && header->node_size == sizeof(utjson) &&
+           header->member_size == sizeof(utjson_member) && header->size == size &&
+           header->relocations <= size && header->count == size - header->relocations &&
+           header->count <= (header->relocations + 63) / 64 &&
+           header->relocations >= BINARY_HEADER + sizeof(utjson);
+}
+
+// a private copy with every pointer shifted to where the image actually is
+static char *binary_relocate(int fd, const binary_header *header)
+{
+    char *image = mmap(NULL, header->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (image == MAP_FAILED)
+        return NULL;
+    uintptr_t delta = (uintptr_t)image - (uintptr_t)header->base;
+    const uint8_t *bitmap = (const uint8_t *)(image + header->relocations);
+    for (uint64_t byte = 0; byte < header->count; byte++)
+    {
+        for (unsigned bits = bitmap[byte]; bits; bits &= bits - 1)
+        {
+            uint64_t slot = (byte * 8 + (unsigned)__builtin_ctz(bits)) * 8;
+            if (slot + sizeof(uintptr_t) > header->relocations)
+            {
+                munmap(image, header->size);
+                errno = EINVAL;
+                return NULL;
+            }
+            uintptr_t pointer;
+            memcpy(&pointer, image + slot, sizeof(pointer));
+            pointer += delta;
+            memcpy(image + slot, &pointer, sizeof(pointer));
+        }
+    }
+    mprotect(image, header->size, PROT_READ);
+    return image;
+}
+
+/**
+ * Maps an image written by utjson_saveBinary()
+ *
+ * @param path
+ * @return utjson*
+ */
+utjson *utjson_mapBinary(const char *path)
+{
+    if (!path)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    binary_header header;
+    struct stat status;
+    if (fstat(fd, &status) < 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        !binary_compatible(&header, status.st_size))
+    {
+        close(fd);
+        errno = EINVAL; // not an image, or one written for another layout
+        return NULL;
+    }
+
+    // shared and untouched at the preferred address, relocated in a private copy elsewhere
+    int flags = MAP_SHARED;
+#ifdef MAP_FIXED_NOREPLACE
+    flags |= MAP_FIXED_NOREPLACE;
+#endif
+    char *image = mmap((void *)(uintptr_t)header.base, header.size, PROT_READ, flags, fd, 0);
+    if (image != MAP_FAILED && (uintptr_t)image != header.base)
+    {
+        munmap(image, header.size); // the address was only a hint
+        image = MAP_FAILED;
+    }
+    if (image == MAP_FAILED)
+    {
+        image = binary_relocate(fd, &header);
+    }
+    close(fd); // the mapping keeps its own reference
+    if (!image)
+        return NULL;
+    return (utjson *)(image + BINARY_HEADER);
+}
+
+/**
+ * Releases the mapping behind the root of an image
+ *
+ * @param root
+ */
+void utjson_binaryUnmap(utjson *root)
+{
+    const binary_header *header = (const binary_header *)((char *)root - BINARY_HEADER);
+    munmap((void *)header, header->size);
+}
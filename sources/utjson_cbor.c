@@ -0,0 +1,627 @@
+#include "utjson_internal.h"
+#include "utjson_simd.h"
+#include <errno.h>
+#include <math.h>
+
+/**
+ * CBOR (RFC 8949) major types
+ */
+enum
+{
+    CBOR_UNSIGNED = 0,
+    CBOR_NEGATIVE = 1,
+    CBOR_BYTES = 2,
+    CBOR_TEXT = 3,
+    CBOR_ARRAY = 4,
+    CBOR_MAP = 5,
+    CBOR_TAG = 6,
+    CBOR_SIMPLE = 7,
+};
+
+#define CBOR_FALSE 0xF4
+#define CBOR_TRUE 0xF5
+#define CBOR_NULL 0xF6
+#define CBOR_UNDEFINED 0xF7
+#define CBOR_HALF 0xF9
+#define CBOR_FLOAT 0xFA
+#define CBOR_DOUBLE 0xFB
+#define CBOR_BREAK 0xFF
+#define CBOR_INDEFINITE 31 /**< Additional information of an item ended by CBOR_BREAK */
+#define CBOR_RESERVE_MAX 64 /**< Elements reserved up front for a definite-length array */
+
+// writes the head of an item: major type and argument in the fewest bytes
+static bool cbor_head(utjson_buffer *buffer, unsigned major, uint64_t argument)
+{
+    if (!utjson_bufferReserve(buffer, 9))
+        return false;
+    uint8_t *out = (uint8_t *)buffer->data + buffer->length;
+    unsigned size = argument < 24            ? 0
+                    : argument <= UINT8_MAX  ? 1
+                    : argument <= UINT16_MAX ? 2
+                    : argument <= UINT32_MAX ? 4
+                                             : 8;
+    // 24..27 announce 1, 2, 4 or 8 argument bytes
+    out[0] = (uint8_t)(major << 5 | (size ? 24 + (unsigned)__builtin_ctz(size) : argument));
+    for (unsigned i = 0; i < size; i++)
+    {
+        out[1 + i] = (uint8_t)(argument >> (8 * (size - 1 - i)));
+    }
+    buffer->length += 1 + size;
+    return true;
+}
+
+static bool cbor_byte(utjson_buffer *buffer, uint8_t byte)
+{
+    if (!utjson_bufferReserve(buffer, 1))
+        return false;
+    buffer->data[buffer->length++] = (char)byte;
+    return true;
+}
+
+// names and short strings are mostly ASCII, which is settled without calling the validator
+static bool cbor_utf8(const char *text, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if ((uint8_t)text[i] & 0x80)
+            return utjson_utf8Valid(text + i, length - i);
+    }
+    return true;
+}
+
+// text strings must be UTF-8: other bytes, which the parsers keep by default, go as a byte string
+static bool cbor_text(utjson_buffer *buffer, const char *text, size_t length)
+{
+    unsigned major = cbor_utf8(text, length) ? CBOR_TEXT : CBOR_BYTES;
+    if (!cbor_head(buffer, major, length) || !utjson_bufferReserve(buffer, length))
+        return false;
+    memcpy(buffer->data + buffer->length, text, length);
+    buffer->length += length;
+    return true;
+}
+
+// the half precision form of value, if it holds value exactly
+static bool cbor_half(float value, uint16_t *half)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (uint16_t)(bits >> 16 & 0x8000);
+    int exponent = (int)(bits >> 23 & 0xFF) - 127;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (!(bits & 0x7FFFFFFF))
+    {
+        *half = sign; // zeros keep their sign
+        return true;
+    }
+    if (exponent == 128)
+    {
+        *half = sign | (mantissa ? 0x7E00 : 0x7C00);
+        return true;
+    }
+    if (exponent >= -14 && exponent <= 15)
+    {
+        if (mantissa & 0x1FFF)
+            return false;
+        *half = sign | (uint16_t)((exponent + 15) << 10) | (uint16_t)(mantissa >> 13);
+        return true;
+    }
+    if (exponent >= -24 && exponent < -14)
+    {
+        // subnormal: the value is m * 2^-24 with m below 1024
+        uint32_t full = 0x800000 | mantissa;
+        int shift = -exponent - 1;
+        if (full & ((1U << shift) - 1))
+            return false;
+        *half = sign | (uint16_t)(full >> shift);
+        return true;
+    }
+    return false;
+}
+
+// a double in the shortest of the three widths that keeps it exactly (preferred serialization)
+static bool cbor_number(utjson_buffer *buffer, double value)
+{
+    if (!utjson_bufferReserve(buffer, 9))
+        return false;
+    uint8_t *out = (uint8_t *)buffer->data + buffer->length;
+    float single = (float)value;
+    uint16_t half;
+    if (value != value)
+    {
+        out[0] = CBOR_HALF, out[1] = 0x7E, out[2] = 0x00; // the canonical NaN
+        buffer->length += 3;
+    }
+    else if ((double)single != value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        out[0] = CBOR_DOUBLE;
+        for (int i = 0; i < 8; i++)
+        {
+            out[1 + i] = (uint8_t)(bits >> (56 - 8 * i));
+        }
+        buffer->length += 9;
+    }
+    else if (cbor_half(single, &half))
+    {
+        out[0] = CBOR_HALF, out[1] = (uint8_t)(half >> 8), out[2] = (uint8_t)half;
+        buffer->length += 3;
+    }
+    else
+    {
+        uint32_t bits;
+        memcpy(&bits, &single, sizeof(bits));
+        out[0] = CBOR_FLOAT;
+        for (int i = 0; i < 4; i++)
+        {
+            out[1 + i] = (uint8_t)(bits >> (24 - 8 * i));
+        }
+        buffer->length += 5;
+    }
+    return true;
+}
+
+static bool cbor_value(utjson_buffer *buffer, const utjson *object)
+{
+    if (!object)
+        return cbor_byte(buffer, CBOR_NULL);
+
+    switch (object->type)
+    {
+    case utjson_NULL:
+        return cbor_byte(buffer, CBOR_NULL);
+    case utjson_BOOL:
+        return cbor_byte(buffer, object->number ? CBOR_TRUE : CBOR_FALSE);
+    case utjson_NUMBER:
+        if (!(object->flags & utjson_INTEGER))
+            return cbor_number(buffer, object->number);
+        if ((object->flags & utjson_UNSIGNED) || object->integer >= 0)
+            return cbor_head(buffer, CBOR_UNSIGNED, object->uinteger);
+        // -1 - n, written as n
+        return cbor_head(buffer, CBOR_NEGATIVE, (uint64_t)(-1 - object->integer));
+    case utjson_STRING:
+        if (!object->string)
+            return cbor_byte(buffer, CBOR_NULL);
+        return cbor_text(buffer, object->string, strlen(object->string));
+    case utjson_ARRAY:
+        if (!cbor_head(buffer, CBOR_ARRAY, object->used))
+            return false;
+        for (size_t i = 0; i < object->used; i++)
+        {
+            if (!cbor_value(buffer, object->children[i]))
+                return false;
+        }
+        return true;
+    case utjson_OBJECT:
+        if (!cbor_head(buffer, CBOR_MAP, object->used))
+            return false;
+        for (size_t i = 0; i < object->used; i++)
+        {
+            const utjson *entry = object->children[i];
+            if (!cbor_text(buffer, entry->name, strlen(entry->name)) || !cbor_value(buffer, entry))
+                return false;
+        }
+        return true;
+    case utjson_POINTER:
+    {
+        // the text utjson_print() gives, which the parsers turn back into a pointer
+        size_t length = strlen(object->pointer_type);
+        unsigned major = cbor_utf8(object->pointer_type, length) ? CBOR_TEXT : CBOR_BYTES;
+        if (!cbor_head(buffer, major, length + 11) || !utjson_bufferReserve(buffer, length + 11))
+            return false;
+        memcpy(buffer->data + buffer->length, "<:", 2);
+        memcpy(buffer->data + buffer->length + 2, object->pointer_type, length);
+        memcpy(buffer->data + buffer->length + 2 + length, ":>pointer", 9);
+        buffer->length += length + 11;
+        return true;
+    }
+    }
+    return true;
+}
+
+/**
+ * Appends the CBOR encoding of a value to the buffer
+ *
+ * @param buffer
+ * @param object
+ * @return true | false
+ */
+bool utjson_toCBORTo(utjson_buffer *buffer, const utjson *object)
+{
+    if (!buffer)
+    {
+        errno = EINVAL;
+        return false;
+    }
+    return cbor_value(buffer, object);
+}
+
+/**
+ * Encodes a value as CBOR into a new buffer
+ *
+ * @param object
+ * @param length
+ * @return uint8_t*
+ */
+uint8_t *utjson_toCBOR(const utjson *object, size_t *length)
+{
+    utjson_buffer buffer = {0};
+    if (!utjson_toCBORTo(&buffer, object))
+    {
+        utjson_bufferFree(&buffer);
+        return NULL;
+    }
+    if (length)
+    {
+        *length = buffer.length;
+    }
+    return (uint8_t *)buffer.data;
+}
+
+/**
+ * Container being filled by the decoder
+ */
+typedef struct
+{
+    utjson *container;  /**< ARRAY or OBJECT */
+    uint64_t remaining; /**< Items (array) or pairs (map) still to come, unless indefinite */
+    bool indefinite;    /**< Ends with CBOR_BREAK */
+} cbor_frame;
+
+/**
+ * Decoder state
+ */
+typedef struct
+{
+    const uint8_t *cursor; /**< Next byte to read */
+    const uint8_t *end;    /**< End of the input */
+    utjson_arena *arena;   /**< Where the nodes go (NULL for the heap) */
+    utjson_buffer name;    /**< Member name waiting for its value */
+    utjson_buffer text;    /**< String value being assembled */
+    cbor_frame *stack;     /**< Open containers, innermost last */
+    size_t depth;          /**< Number of open containers */
+    size_t allocated;      /**< Capacity of stack */
+} cbor_decoder;
+
+static bool cbor_malformed(void)
+{
+    errno = EINVAL;
+    return false;
+}
+
+// reads the head at the cursor; info receives the additional information
+static bool cbor_read_head(cbor_decoder *decoder, unsigned *major, unsigned *info, uint64_t *argument)
+{
+    if (decoder->cursor >= decoder->end)
+        return cbor_malformed();
+    uint8_t initial = *decoder->cursor++;
+    *major = initial >> 5;
+    *info = initial & 0x1F;
+    *argument = 0;
+    if (*info < 24)
+    {
+        *argument = *info;
+        return true;
+    }
+    if (*info == CBOR_INDEFINITE)
+    {
+        // only strings, arrays and maps have an indefinite form; a break is never an item
+        if (*major == CBOR_BYTES || *major == CBOR_TEXT || *major == CBOR_ARRAY || *major == CBOR_MAP)
+            return true;
+        return cbor_malformed();
+    }
+    size_t size = (size_t)1 << (*info - 24);
+    if (*info > 27 || (size_t)(decoder->end - decoder->cursor) < size)
+        return cbor_malformed(); // reserved or truncated
+    for (size_t i = 0; i < size; i++)
+    {
+        *argument = *argument << 8 | decoder->cursor[i];
+    }
+    decoder->cursor += size;
+    return true;
+}
+
+// reads the head of the next item, stepping over the tags that annotate it
+static bool cbor_read_item(cbor_decoder *decoder, unsigned *major, unsigned *info, uint64_t *argument)
+{
+    do
+    {
+        if (!cbor_read_head(decoder, major, info, argument))
+            return false;
+    } while (*major == CBOR_TAG);
+    return true;
+}
+
+/**
+ * Replaces the bytes in out by their base64url text without padding
+ *
+ * The JSON form of a byte string that RFC 8949 section 6.1 suggests. Groups
+ * are encoded from the last one, so each lands over input already read.
+ */
+static bool cbor_base64url(utjson_buffer *out)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    size_t length = out->length;
+    size_t encoded = length / 3 * 4 + (length % 3 ? length % 3 + 1 : 0);
+    if (!utjson_bufferReserve(out, encoded - length))
+        return false;
+    uint8_t *data = (uint8_t *)out->data;
+    for (size_t group = (length + 2) / 3; group-- > 0;)
+    {
+        size_t in = group * 3;
+        size_t size = length - in < 3 ? length - in : 3;
+        uint32_t bits = (uint32_t)data[in] << 16 | (size > 1 ? (uint32_t)data[in + 1] << 8 : 0) |
+                        (size > 2 ? data[in + 2] : 0);
+        for (size_t i = size + 1; i-- > 0;)
+        {
+            data[group * 4 + i] = (uint8_t)alphabet[bits >> (18 - 6 * i) & 0x3F];
+        }
+    }
+    out->length = encoded;
+    return true;
+}
+
+// collects a byte or text string, definite or in chunks, NUL-terminated into out
+static bool cbor_read_string(cbor_decoder *decoder, utjson_buffer *out, unsigned major, unsigned info,
+                             uint64_t length)
+{
+    out->length = 0;
+    bool chunked = info == CBOR_INDEFINITE;
+    for (;;)
+    {
+        if (chunked)
+        {
+            if (decoder->cursor < decoder->end && *decoder->cursor == CBOR_BREAK)
+            {
+                decoder->cursor++;
+                break;
+            }
+            // every chunk is a definite string of the same major type
+            unsigned chunk_major, chunk_info;
+            if (!cbor_read_head(decoder, &chunk_major, &chunk_info, &length))
+                return false;
+            if (chunk_major != major || chunk_info == CBOR_INDEFINITE)
+                return cbor_malformed();
+        }
+        if (length > (uint64_t)(decoder->end - decoder->cursor))
+            return cbor_malformed();
+        if (!utjson_bufferReserve(out, length))
+            return false;
+        memcpy(out->data + out->length, decoder->cursor, length);
+        out->length += length;
+        decoder->cursor += length;
+        if (!chunked)
+            break;
+    }
+    // strings end at their first NUL here, so one inside would cut them short
+    if (major == CBOR_TEXT && (memchr(out->data, '\0', out->length) || !utjson_utf8Valid(out->data, out->length)))
+        return cbor_malformed();
+    if (major == CBOR_BYTES && !cbor_base64url(out))
+        return false;
+    if (!utjson_bufferReserve(out, 0))
+        return false;
+    out->data[out->length] = '\0';
+    return true;
+}
+
+static utjson *cbor_string_node(cbor_decoder *decoder)
+{
+    char *text = decoder->text.data;
+    size_t length = decoder->text.length;
+    // "<:type:>pointer" is read back as utjson_parse() does
+    if (length >= 11 && memcmp(text, "<:", 2) == 0 && memcmp(text + length - 9, ":>pointer", 9) == 0)
+    {
+        text[length - 9] = '\0';
+        return utjson_createPointerIn(decoder->arena, NULL, text + 2);
+    }
+    utjson *node = utjson_createStringIn(decoder->arena, NULL);
+    if (!node)
+        return NULL;
+    node->string = decoder->arena ? utjson_arenaStrndup(decoder->arena, text, length) : strdup(text);
+    if (!node->string)
+    {
+        errno = ENOMEM;
+        return utjson_destruct(node);
+    }
+    return node;
+}
+
+static double cbor_half_value(uint16_t half)
+{
+    unsigned exponent = half >> 10 & 0x1F;
+    unsigned mantissa = half & 0x3FF;
+    double value;
+    if (exponent == 0)
+    {
+        value = mantissa / 16777216.0; // mantissa * 2^-24
+    }
+    else if (exponent != 31)
+    {
+        value = (mantissa + 1024) * (double)(1ULL << exponent) / 33554432.0; // (1024 + mantissa) * 2^(exponent - 25)
+    }
+    else
+    {
+        value = mantissa ? NAN : INFINITY;
+    }
+    return half & 0x8000 ? -value : value;
+}
+
+// decodes the scalar or creates the container whose head was just read
+static utjson *cbor_item(cbor_decoder *decoder, unsigned major, unsigned info, uint64_t argument)
+{
+    switch (major)
+    {
+    case CBOR_UNSIGNED:
+        return utjson_createUint64In(decoder->arena, argument);
+    case CBOR_NEGATIVE:
+        if (argument <= (uint64_t)INT64_MAX)
+            return utjson_createInt64In(decoder->arena, -1 - (int64_t)argument);
+        return utjson_createNumberIn(decoder->arena, -1.0 - (double)argument); // past int64_t
+    case CBOR_BYTES:
+    case CBOR_TEXT:
+        return cbor_read_string(decoder, &decoder->text, major, info, argument) ? cbor_string_node(decoder) : NULL;
+    case CBOR_ARRAY:
+    {
+        // every item takes a byte at least, which bounds what a count can reserve
+        if (info != CBOR_INDEFINITE && argument > (uint64_t)(decoder->end - decoder->cursor))
+            break;
+        // but nested heads could each claim the rest of the input: past a few, utjson_add() grows the array
+        utjson *array = utjson_createArrayIn(decoder->arena);
+        size_t reserve = argument < CBOR_RESERVE_MAX ? (size_t)argument : CBOR_RESERVE_MAX;
+        if (array && reserve && !utjson_arrayReserve(array, reserve))
+            return utjson_destruct(array);
+        return array;
+    }
+    case CBOR_MAP:
+        if (info != CBOR_INDEFINITE && argument > (uint64_t)(decoder->end - decoder->cursor) / 2)
+            break;
+        return utjson_createObjectIn(decoder->arena);
+    case CBOR_SIMPLE:
+        switch (info)
+        {
+        case CBOR_FALSE & 0x1F:
+        case CBOR_TRUE & 0x1F:
+            return utjson_createBoolIn(decoder->arena, info == (CBOR_TRUE & 0x1F));
+        case CBOR_NULL & 0x1F:
+        case CBOR_UNDEFINED & 0x1F:
+            return utjson_createNullIn(decoder->arena);
+        case CBOR_HALF & 0x1F:
+            return utjson_createNumberIn(decoder->arena, cbor_half_value((uint16_t)argument));
+        case CBOR_FLOAT & 0x1F:
+        {
+            uint32_t bits = (uint32_t)argument;
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return utjson_createNumberIn(decoder->arena, value);
+        }
+        case CBOR_DOUBLE & 0x1F:
+        {
+            double value;
+            memcpy(&value, &argument, sizeof(value));
+            return utjson_createNumberIn(decoder->arena, value);
+        }
+        }
+        break; // other simple values have no JSON counterpart
+    }
+    errno = EINVAL;
+    return NULL;
+}
+
+static bool cbor_push(cbor_decoder *decoder, utjson *container, uint64_t count, bool indefinite)
+{
+    if (decoder->depth == decoder->allocated)
+    {
+        size_t allocated = decoder->allocated ? decoder->allocated * 2 : 16;
+        cbor_frame *stack = realloc(decoder->stack, allocated * sizeof(cbor_frame));
+        if (!stack)
+        {
+            errno = ENOMEM;
+            return false;
+        }
+        decoder->stack = stack;
+        decoder->allocated = allocated;
+    }
+    decoder->stack[decoder->depth++] = (cbor_frame){.container = container, .remaining = count, .indefinite = indefinite};
+    return true;
+}
+
+/**
+ * Decodes one item with an explicit stack, so nesting costs no C stack
+ *
+ * Every value is attached to its container as soon as it is created, so root
+ * owns everything decoded so far, also on failure.
+ */
+static bool cbor_decode(cbor_decoder *decoder, utjson **root)
+{
+    do
+    {
+        cbor_frame *top = decoder->depth ? &decoder->stack[decoder->depth - 1] : NULL;
+        if (top && (top->indefinite ? decoder->cursor < decoder->end && *decoder->cursor == CBOR_BREAK
+                                    : !top->remaining))
+        {
+            decoder->cursor += top->indefinite;
+            decoder->depth--;
+            continue;
+        }
+
+        unsigned major, info;
+        uint64_t argument;
+        bool member = top && utjson_IS(OBJECT, top->container);
+        if (member)
+        {
+            // names are text (or byte) strings
+            if (!cbor_read_item(decoder, &major, &info, &argument))
+                return false;
+            if (major != CBOR_TEXT && major != CBOR_BYTES)
+                return cbor_malformed();
+            if (!cbor_read_string(decoder, &decoder->name, major, info, argument))
+                return false;
+        }
+        if (!cbor_read_item(decoder, &major, &info, &argument))
+            return false;
+
+        utjson *value = cbor_item(decoder, major, info, argument);
+        if (!value)
+            return false;
+        if (!top)
+        {
+            *root = value;
+        }
+        else if (!(member ? utjson_setMember(top->container, decoder->name.data, value, 0)
+                          : utjson_add(top->container, value)))
+        {
+            utjson_destruct(value);
+            return false;
+        }
+        else if (!top->indefinite)
+        {
+            top->remaining--;
+        }
+        if ((major == CBOR_ARRAY || major == CBOR_MAP) &&
+            !cbor_push(decoder, value, argument, info == CBOR_INDEFINITE))
+            return false;
+    } while (decoder->depth);
+    return true;
+}
+
+/**
+ * Decodes CBOR into a tree placed in the arena
+ *
+ * @param arena
+ * @param data
+ * @param length
+ * @return utjson*
+ */
+utjson *utjson_fromCBORIn(utjson_arena *arena, const uint8_t *data, size_t length)
+{
+    if (!data || !length)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    cbor_decoder decoder = {.cursor = data, .end = data + length, .arena = arena};
+    utjson *root = NULL;
+    bool decoded = cbor_decode(&decoder, &root);
+    if (decoded && decoder.cursor != decoder.end)
+    {
+        decoded = cbor_malformed(); // one item, nothing after it
+    }
+    free(decoder.stack);
+    utjson_bufferFree(&decoder.name);
+    utjson_bufferFree(&decoder.text);
+    if (!decoded)
+        return utjson_destruct(root);
+    return root;
+}
+
+/**
+ * Decodes CBOR into a tree
+ *
+ * @param data
+ * @param length
+ * @return utjson*
+ */
+utjson *utjson_fromCBOR(const uint8_t *data, size_t length)
+{
+    return utjson_fromCBORIn(NULL, data, length);
+}
@@ -0,0 +1,155 @@
+#include "utjson_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * File contents mapped into memory
+ */
+typedef struct
+{
+    char *data;    /**< First byte of the file */
+    size_t length; /**< File size */
+} file_mapping;
+
+/**
+ * Maps the whole file; a private writable mapping keeps changes out of the file
+ *
+ * @param path
+ * @param writable
+ * @param mapping
+ * @return true | false
+ */
+static bool file_map(const char *path, bool writable, file_mapping *mapping)
+{
+    if (!path)
+    {
+        errno = EINVAL;
+        return false;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(fd, &status) < 0)
+    {
+        close(fd);
+        return false;
+    }
+    if (!S_ISREG(status.st_mode))
+    {
+        close(fd);
+        errno = EINVAL;
+        return false;
+    }
+
+    mapping->length = status.st_size;
+    if (!mapping->length)
+    {
+        // mmap() refuses empty ranges
+        close(fd);
+        mapping->data = NULL;
+        return true;
+    }
+    mapping->data = mmap(NULL, mapping->length, PROT_READ | (writable ? PROT_WRITE : 0), MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps its own reference
+    if (mapping->data == MAP_FAILED)
+        return false;
+
+    // the parsers walk the input once from front to back; the hints are best effort
+    madvise(mapping->data, mapping->length, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(mapping->data, mapping->length, MADV_HUGEPAGE);
+#endif
+    return true;
+}
+
+static void file_unmap(void *data)
+{
+    file_mapping *mapping = data;
+    if (mapping->length)
+    {
+        munmap(mapping->data, mapping->length);
+    }
+}
+
+/**
+ * Parses a file into a document placed in the arena
+ *
+ * @param arena
+ * @param path
+ * @param flags
+ * @return utjson*
+ */
+utjson *utjson_parseFileIn(utjson_arena *arena, const char *path, unsigned flags)
+{
+    // borrowing needs a mapping that lives as long as the document, i.e. as long as the arena
+    if (!arena)
+    {
+        flags &= ~utjson_PARSE_IN_PLACE;
+    }
+
+    file_mapping mapping;
+    if (!file_map(path, flags & utjson_PARSE_IN_PLACE, &mapping))
+        return NULL;
+    if (!mapping.length)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    utjson *root = utjson_parseDocument(arena, mapping.data, mapping.length, flags);
+    if (root && (flags & utjson_PARSE_IN_PLACE))
+    {
+        file_mapping *kept = utjson_arenaAlloc(arena, sizeof(file_mapping));
+        if (kept)
+        {
+            *kept = mapping;
+            if (utjson_arenaDefer(arena, file_unmap, kept))
+                return root;
+        }
+        // the nodes stay in the arena until its reset, but they must not point into the file
+        root = NULL;
+        errno = ENOMEM;
+    }
+    file_unmap(&mapping);
+    return root;
+}
+
+/**
+ * Parses a file
+ *
+ * @param path
+ * @param flags
+ * @return utjson*
+ */
+utjson *utjson_parseFile(const char *path, unsigned flags)
+{
+    return utjson_parseFileIn(NULL, path, flags);
+}
+
+/**
+ * Parses a newline-delimited JSON file on a pool of threads
+ *
+ * @param path
+ * @param workers
+ * @param flags
+ * @param callback
+ * @param user
+ * @return true | false
+ */
+bool utjson_parseLinesFile(const char *path, size_t workers, unsigned flags, utjson_line_callback callback, void *user)
+{
+    file_mapping mapping;
+    if (!file_map(path, false, &mapping))
+        return false;
+
+    bool result = utjson_parseLines(mapping.data, mapping.length, workers, flags, callback, user);
+    int error = errno;
+    file_unmap(&mapping);
+    errno = error;
+    return result;
+}
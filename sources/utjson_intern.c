@@ -0,0 +1,197 @@
+#include "utjson_internal.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+
+#define INTERN_INITIAL 256 /**< Initial slot count, a power of two */
+
+/**
+ * Interned string with its uthash hash, allocated from the pool arena
+ */
+typedef struct
+{
+    unsigned hashv; /**< HASH_VALUE() of text */
+    uint32_t length; /**< strlen(text) */
+    char text[];    /**< NUL-terminated bytes, handed out to callers */
+} intern_entry;
+
+/**
+ * Thread-safe string pool: every distinct string is stored once
+ */
+struct utjson_intern
+{
+    pthread_rwlock_t lock;  /**< Readers probe concurrently, inserts are exclusive */
+    utjson_arena *arena;    /**< Storage of the entries */
+    intern_entry **slots;   /**< Open addressing table, linear probing */
+    size_t allocated;       /**< Number of slots, a power of two */
+    size_t used;            /**< Number of entries */
+};
+
+#define intern_entry_of(string) ((intern_entry *)((char *)(string) - offsetof(intern_entry, text)))
+
+/**
+ * Creates an intern pool
+ *
+ * @return utjson_intern*
+ */
+utjson_intern *utjson_internCreate(void)
+{
+    utjson_intern *pool = calloc(1, sizeof(utjson_intern));
+    if (pool)
+    {
+        pool->arena = utjson_arenaCreate(0);
+        pool->slots = calloc(INTERN_INITIAL, sizeof(intern_entry *));
+        pool->allocated = INTERN_INITIAL;
+    }
+    if (!pool || !pool->arena || !pool->slots)
+    {
+        if (pool)
+        {
+            utjson_arenaDestroy(pool->arena);
+            free(pool->slots);
+            free(pool);
+        }
+        errno = ENOMEM;
+        return NULL;
+    }
+    pthread_rwlock_init(&pool->lock, NULL);
+    return pool;
+}
+
+/**
+ * Destroys the pool and all its strings
+ *
+ * @param pool
+ * @return utjson_intern*
+ */
+utjson_intern *utjson_internDestroy(utjson_intern *pool)
+{
+    if (pool)
+    {
+        pthread_rwlock_destroy(&pool->lock);
+        utjson_arenaDestroy(pool->arena);
+        free(pool->slots);
+        free(pool);
+    }
+    return NULL;
+}
+
+static intern_entry *intern_find(const utjson_intern *pool, const char *text, size_t length, unsigned hashv,
+                                 size_t *slot)
+{
+    size_t mask = pool->allocated - 1;
+    for (size_t i = hashv & mask;; i = (i + 1) & mask)
+    {
+        intern_entry *entry = pool->slots[i];
+        if (!entry || (entry->hashv == hashv && entry->length == length && !memcmp(entry->text, text, length)))
+        {
+            *slot = i;
+            return entry;
+        }
+    }
+}
+
+static bool intern_grow(utjson_intern *pool)
+{
+    size_t allocated = pool->allocated * 2;
+    intern_entry **slots = calloc(allocated, sizeof(intern_entry *));
+    if (!slots)
+        return false;
+    for (size_t i = 0; i < pool->allocated; i++)
+    {
+        intern_entry *entry = pool->slots[i];
+        if (entry)
+        {
+            size_t j = entry->hashv & (allocated - 1);
+            while (slots[j])
+                j = (j + 1) & (allocated - 1);
+            slots[j] = entry;
+        }
+    }
+    free(pool->slots);
+    pool->slots = slots;
+    pool->allocated = allocated;
+    return true;
+}
+
+/**
+ * Returns the pooled copy of length bytes at text, adding it if new
+ *
+ * @param pool
+ * @param text
+ * @param length
+ * @return const char* valid until the pool is destroyed
+ */
+const char *utjson_internString(utjson_intern *pool, const char *text, size_t length)
+{
+    if (!pool || (!text && length) || length > UINT32_MAX)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    unsigned hashv;
+    HASH_VALUE(text, length, hashv);
+
+    size_t slot;
+    pthread_rwlock_rdlock(&pool->lock);
+    intern_entry *entry = intern_find(pool, text, length, hashv, &slot);
+    pthread_rwlock_unlock(&pool->lock);
+    if (entry)
+        return entry->text;
+
+    pthread_rwlock_wrlock(&pool->lock);
+    // another thread may have added it in between
+    entry = intern_find(pool, text, length, hashv, &slot);
+    if (!entry && (pool->used + 1) * 2 > pool->allocated)
+    {
+        if (!intern_grow(pool))
+        {
+            pthread_rwlock_unlock(&pool->lock);
+            errno = ENOMEM;
+            return NULL;
+        }
+        intern_find(pool, text, length, hashv, &slot);
+    }
+    if (!entry)
+    {
+        entry = utjson_arenaAlloc(pool->arena, sizeof(intern_entry) + length + 1);
+        if (entry)
+        {
+            entry->hashv = hashv;
+            entry->length = (uint32_t)length;
+            memcpy(entry->text, text, length);
+            entry->text[length] = '\0';
+            pool->slots[slot] = entry;
+            pool->used++;
+        }
+    }
+    pthread_rwlock_unlock(&pool->lock);
+    if (!entry)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return entry->text;
+}
+
+/**
+ * uthash hash of an interned string
+ *
+ * @param interned
+ * @return unsigned
+ */
+unsigned utjson_internHash(const char *interned)
+{
+    return intern_entry_of(interned)->hashv;
+}
+
+/**
+ * Length of an interned string
+ *
+ * @param interned
+ * @return size_t
+ */
+size_t utjson_internLength(const char *interned)
+{
+    return intern_entry_of(interned)->length;
+}
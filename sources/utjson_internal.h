@@ -0,0 +1,147 @@
+#ifndef UTJSON_INTERNAL_H
+#define UTJSON_INTERNAL_H
+
+/**
+ * Internals shared by the library modules (not part of the public API)
+ */
+
+#include "utjson.h"
+
+#define utjson_NUMBER_TEXT 32 /**< Room for any double written by utjson_numberFormat() */
+
+/**
+ * Parser state shared by the parse_* functions
+ */
+typedef struct
+{
+    char *cursor;          /**< Next byte to read */
+    char *end;             /**< End of the input */
+    utjson_arena *arena;   /**< Where the nodes go (NULL for the heap) */
+    bool in_place;         /**< Strings and keys borrow the input bytes */
+    bool integers;         /**< Integral numbers become utjson_INTEGER nodes */
+    utjson_intern *intern; /**< Pool for member names (NULL: names are copied or borrowed) */
+    bool intern_values;    /**< Short string values come from intern too */
+    bool validate_utf8;    /**< Strings and keys must be well-formed UTF-8 */
+    utjson_buffer scratch; /**< Reusable storage for keys */
+} parse_context;
+
+/**
+ * @brief Parses the value at ctx->cursor, advancing the cursor past it.
+ */
+utjson *utjson_parseValue(parse_context *ctx);
+
+/**
+ * @brief Reads the number at ctx->cursor without creating a node.
+ */
+bool utjson_parseNumber(parse_context *ctx, double *number);
+
+/**
+ * Number read by utjson_numberScan()
+ */
+typedef struct
+{
+    double value;       /**< Correctly rounded value */
+    uint64_t magnitude; /**< Exact absolute value if integral */
+    bool negative;      /**< Leading minus sign */
+    bool integral;      /**< No fraction or exponent, magnitude fits 64 bits, not -0 */
+} utjson_number_token;
+
+/**
+ * @brief Reads a strict JSON number at start (never past end), correctly rounded and locale-independent.
+ * @return Number of bytes read, 0 if start holds no number.
+ */
+size_t utjson_numberScan(const char *start, const char *end, utjson_number_token *token);
+
+/**
+ * @brief utjson_numberScan() for the value only.
+ */
+size_t utjson_numberParse(const char *start, const char *end, double *value);
+
+/**
+ * @brief Writes an integer given as sign and magnitude.
+ * @param text At least utjson_NUMBER_TEXT bytes.
+ * @return Length of the NUL-terminated text.
+ */
+size_t utjson_integerFormat(uint64_t magnitude, bool negative, char *text);
+
+/**
+ * @brief Writes the shortest text that reads back as value ("null" for NaN and infinities).
+ * @param text At least utjson_NUMBER_TEXT bytes.
+ * @return Length of the NUL-terminated text.
+ */
+size_t utjson_numberFormat(double value, char *text);
+
+/**
+ * @brief Writes the text utjson_asString() gives for a BOOL or NUMBER node.
+ * @param text At least utjson_NUMBER_TEXT bytes.
+ * @return Length of the NUL-terminated text.
+ */
+size_t utjson_nodeFormat(const utjson *object, char *text);
+
+/**
+ * @brief Releases the mapping of an image, given its root (see utjson_mapBinary()).
+ */
+void utjson_binaryUnmap(utjson *root);
+
+/**
+ * @brief Turns the raw bytes of a member name (without quotes) into a key.
+ * @return NUL-terminated key, valid until the next call with the same ctx.
+ */
+char *utjson_parseKey(parse_context *ctx, char *start, size_t length);
+
+/**
+ * @brief Decodes the escapes of a string body into out (may be text); returns the length or SIZE_MAX on a bad escape.
+ */
+size_t utjson_unescape(char *out, const char *text, size_t length);
+
+/**
+ * @brief Closing quote of the string whose body starts at text, NULL if it is unterminated.
+ */
+char *utjson_stringEnd(char *text, const char *end);
+
+/**
+ * @brief Reads the four hex digits of a \\u escape.
+ */
+bool utjson_hex4(const char *text, unsigned *code);
+
+/**
+ * @brief Appends code as UTF-8 (up to 4 bytes) and returns the new end.
+ */
+char *utjson_utf8Put(char *out, unsigned code);
+
+/**
+ * @brief Parses length bytes at source (no NUL needed) with the engine picked by flags.
+ */
+utjson *utjson_parseDocument(utjson_arena *arena, char *source, size_t length, unsigned flags);
+
+/**
+ * @brief Runs release(data) on the next reset or destroy of the arena (latest registration first).
+ */
+bool utjson_arenaDefer(utjson_arena *arena, void (*release)(void *data), void *data);
+
+/**
+ * @brief Stores object under name in target; name_flags (utjson_BORROWED_NAME, utjson_INTERNED_NAME) say who owns name.
+ */
+utjson *utjson_setMember(utjson *target, char *name, utjson *object, uint8_t name_flags);
+
+/**
+ * @brief uthash hash of a string returned by utjson_internString().
+ */
+unsigned utjson_internHash(const char *interned);
+
+/**
+ * @brief Length of a string returned by utjson_internString().
+ */
+size_t utjson_internLength(const char *interned);
+
+/**
+ * @brief Number of reference tokens of a compiled pointer.
+ */
+size_t utjson_pointerLength(const utjson_pointer *pointer);
+
+/**
+ * @brief Reference token at depth (< utjson_pointerLength()); index receives it as an array index or SIZE_MAX.
+ */
+const utjson_key *utjson_pointerToken(const utjson_pointer *pointer, size_t depth, size_t *index);
+
+#endif // UTJSON_INTERNAL_H
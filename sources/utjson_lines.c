@@ -0,0 +1,283 @@
+#include "utjson_internal.h"
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define LINES_WINDOW 4 /**< Batches in flight per worker before the workers wait for the callback */
+
+/**
+ * Parsed record of a batch
+ */
+typedef struct
+{
+    size_t offset;    /**< Byte offset of the record in the input */
+    utjson *document; /**< Parsed record, NULL if malformed */
+} lines_record;
+
+/**
+ * Records of one run of whole lines, parsed by one worker
+ */
+typedef struct lines_batch
+{
+    struct lines_batch *next; /**< Next completed batch */
+    size_t sequence;          /**< Position of the batch in the input */
+    size_t count;             /**< Number of records */
+    size_t allocated;         /**< Capacity of records */
+    lines_record *records;    /**< Records in input order */
+} lines_batch;
+
+/**
+ * State shared by the workers and the calling thread
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t ready;     /**< A batch was completed */
+    pthread_cond_t room;      /**< A batch was delivered */
+    const char *source;       /**< Input */
+    size_t length;            /**< Input length */
+    unsigned flags;           /**< Engine flags for every record */
+    size_t window;            /**< Maximum batches between issued and delivered */
+    size_t offset;            /**< Start of the next batch */
+    size_t issued;            /**< Batches handed to workers */
+    size_t delivered;         /**< Batches given to the callback */
+    size_t running;           /**< Workers still running */
+    lines_batch *completed;   /**< Completed batches, not yet delivered */
+    bool stop;                /**< The callback stopped or a batch failed */
+    int error;                /**< errno to report */
+} lines_pool;
+
+static void batch_free(lines_batch *batch)
+{
+    for (size_t i = 0; i < batch->count; i++)
+    {
+        utjson_destruct(batch->records[i].document);
+    }
+    free(batch->records);
+    free(batch);
+}
+
+static bool batch_add(lines_batch *batch, size_t offset, utjson *document)
+{
+    if (batch->count == batch->allocated)
+    {
+        size_t allocated = batch->allocated ? batch->allocated * 2 : utjson_ARRAY_INCREMENT;
+        lines_record *records = realloc(batch->records, allocated * sizeof(lines_record));
+        if (!records)
+            return false;
+        batch->records = records;
+        batch->allocated = allocated;
+    }
+    batch->records[batch->count++] = (lines_record){offset, document};
+    return true;
+}
+
+/**
+ * Parses every non-blank line of [start, end) into the batch
+ */
+static bool batch_parse(lines_pool *pool, lines_batch *batch, size_t start, size_t end)
+{
+    // the engines only read, so the const input can be handed over as is
+    char *source = (char *)pool->source;
+    unsigned flags = pool->flags & ~(utjson_PARSE_IN_PLACE | utjson_PARSE_UNORDERED);
+
+    while (start < end)
+    {
+        char *newline = memchr(source + start, '\n', end - start);
+        size_t stop = newline ? (size_t)(newline - source) : end;
+        size_t first = start;
+        while (first < stop && (source[first] == ' ' || source[first] == '\t' || source[first] == '\r'))
+            first++;
+        if (first < stop)
+        {
+            utjson *document = utjson_parseDocument(NULL, source + first, stop - first, flags);
+            if (!batch_add(batch, start, document))
+            {
+                utjson_destruct(document);
+                return false;
+            }
+        }
+        start = stop + 1;
+    }
+    return true;
+}
+
+static void *lines_worker(void *argument)
+{
+    lines_pool *pool = argument;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->stop && pool->offset < pool->length && pool->issued - pool->delivered >= pool->window)
+            pthread_cond_wait(&pool->room, &pool->lock);
+        if (pool->stop || pool->offset >= pool->length)
+            break;
+
+        // a batch ends right after the first newline past utjson_LINES_BATCH bytes
+        size_t start = pool->offset;
+        size_t end = pool->length;
+        if (end - start > utjson_LINES_BATCH)
+        {
+            const char *newline = memchr(pool->source + start + utjson_LINES_BATCH, '\n',
+                                         end - start - utjson_LINES_BATCH);
+            end = newline ? (size_t)(newline - pool->source) + 1 : end;
+        }
+        pool->offset = end;
+        size_t sequence = pool->issued++;
+        pthread_mutex_unlock(&pool->lock);
+
+        lines_batch *batch = calloc(1, sizeof(lines_batch));
+        bool parsed = batch && batch_parse(pool, batch, start, end);
+
+        pthread_mutex_lock(&pool->lock);
+        if (!parsed)
+        {
+            if (batch)
+            {
+                batch_free(batch);
+            }
+            pool->stop = true;
+            pool->error = ENOMEM;
+            pthread_cond_broadcast(&pool->room);
+            break;
+        }
+        batch->sequence = sequence;
+        batch->next = pool->completed;
+        pool->completed = batch;
+        pthread_cond_signal(&pool->ready);
+    }
+    pool->running--;
+    pthread_cond_signal(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/**
+ * Takes the next batch to deliver off the completed list, waiting for it
+ *
+ * @param pool
+ * @param ordered
+ * @return lines_batch* or NULL when done
+ */
+static lines_batch *lines_next(lines_pool *pool, bool ordered)
+{
+    while (!pool->stop)
+    {
+        lines_batch **link = &pool->completed;
+        while (*link && ordered && (*link)->sequence != pool->delivered)
+            link = &(*link)->next;
+        if (*link)
+        {
+            lines_batch *batch = *link;
+            *link = batch->next;
+            return batch;
+        }
+        if (!pool->running)
+            break;
+        pthread_cond_wait(&pool->ready, &pool->lock);
+    }
+    return NULL;
+}
+
+/**
+ * Parses newline-delimited JSON on a pool of threads
+ *
+ * @param source
+ * @param length
+ * @param workers
+ * @param flags
+ * @param callback
+ * @param user
+ * @return true | false
+ */
+bool utjson_parseLines(const char *source, size_t length, size_t workers, unsigned flags,
+                       utjson_line_callback callback, void *user)
+{
+    if ((!source && length) || !callback)
+    {
+        errno = EINVAL;
+        return false;
+    }
+    if (!workers)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = online > 0 ? (size_t)online : 1;
+    }
+
+    lines_pool pool = {
+        .source = source,
+        .length = length,
+        .flags = flags,
+        .window = workers * LINES_WINDOW,
+    };
+    pthread_t *threads = calloc(workers, sizeof(pthread_t));
+    if (!threads)
+    {
+        errno = ENOMEM;
+        return false;
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.ready, NULL);
+    pthread_cond_init(&pool.room, NULL);
+
+    pthread_mutex_lock(&pool.lock);
+    size_t started = 0;
+    while (started < workers && pthread_create(&threads[started], NULL, lines_worker, &pool) == 0)
+    {
+        started++;
+    }
+    pool.running = started;
+    if (!started)
+    {
+        pool.stop = true;
+        pool.error = EAGAIN;
+    }
+
+    lines_batch *batch;
+    while ((batch = lines_next(&pool, !(flags & utjson_PARSE_UNORDERED))))
+    {
+        pthread_mutex_unlock(&pool.lock);
+        bool stopped = false;
+        for (size_t i = 0; i < batch->count && !stopped; i++)
+        {
+            utjson *document = batch->records[i].document;
+            batch->records[i].document = NULL; // handed over to the callback
+            stopped = !callback(user, batch->records[i].offset, document);
+        }
+        batch_free(batch);
+        pthread_mutex_lock(&pool.lock);
+        pool.delivered++;
+        if (stopped)
+        {
+            pool.stop = true;
+            pool.error = ECANCELED;
+        }
+        pthread_cond_broadcast(&pool.room);
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    for (size_t i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    // batches completed after a stop were never delivered
+    while (pool.completed)
+    {
+        batch = pool.completed;
+        pool.completed = batch->next;
+        batch_free(batch);
+    }
+    pthread_cond_destroy(&pool.room);
+    pthread_cond_destroy(&pool.ready);
+    pthread_mutex_destroy(&pool.lock);
+
+    if (pool.error)
+    {
+        errno = pool.error;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,910 @@
+#include "utjson_internal.h"
+#include <ctype.h>
+#include <errno.h>
+
+#define is_json_whitespace(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+#define is_name_first(c) (isalpha((unsigned char)(c)) || (c) == '_' || (unsigned char)(c) >= 0x80)
+#define is_name_char(c) (is_name_first(c) || isdigit((unsigned char)(c)))
+
+typedef struct path_step path_step;
+typedef struct path_expr path_expr;
+
+/**
+ * What a selector picks from the children of a node
+ */
+typedef enum
+{
+    SELECT_NAME,     /**< Object member by name */
+    SELECT_INDEX,    /**< Array element, negative from the end */
+    SELECT_WILDCARD, /**< Every member or element */
+    SELECT_SLICE,    /**< Array elements start:end:step */
+    SELECT_FILTER,   /**< Members or elements the filter holds for */
+} path_selector_kind;
+
+/**
+ * One selector of a bracketed list (or the only one of a dot segment)
+ */
+typedef struct path_selector
+{
+    struct path_selector *next; /**< Next selector of the same segment */
+    path_selector_kind kind;
+    utjson_key key;     /**< SELECT_NAME */
+    int64_t index;      /**< SELECT_INDEX, or the slice start */
+    int64_t end;        /**< Slice end */
+    int64_t step;       /**< Slice step */
+    bool has_start;     /**< The slice names its start */
+    bool has_end;       /**< The slice names its end */
+    path_expr *filter;  /**< SELECT_FILTER */
+} path_selector;
+
+/**
+ * One segment of a query: ".name", "[...]" or the descendant forms "..name", "..[...]"
+ */
+struct path_step
+{
+    path_step *next;          /**< Following segment */
+    bool descendant;          /**< Applies to the node and all its descendants */
+    path_selector *selectors; /**< Matches are produced in selector order */
+};
+
+/**
+ * Comparison operators of filter expressions
+ */
+typedef enum
+{
+    COMPARE_EQUAL,
+    COMPARE_NOT_EQUAL,
+    COMPARE_LESS,
+    COMPARE_LESS_EQUAL,
+    COMPARE_GREATER,
+    COMPARE_GREATER_EQUAL,
+} path_compare;
+
+/**
+ * Side of a comparison: a literal or a singular query
+ */
+typedef struct
+{
+    utjson *literal;  /**< Constant owned by the plan, NULL for a query */
+    path_step *steps; /**< Singular query (names and indices only) */
+    bool absolute;    /**< The query starts at '$' instead of '@' */
+} path_operand;
+
+/**
+ * Node of a filter expression
+ */
+typedef enum
+{
+    EXPR_OR,
+    EXPR_AND,
+    EXPR_NOT,
+    EXPR_COMPARE,
+    EXPR_EXISTS, /**< The query in left (of an operand) selects anything */
+} path_expr_kind;
+
+struct path_expr
+{
+    path_expr_kind kind;
+    path_compare op;        /**< EXPR_COMPARE */
+    path_expr *first;       /**< EXPR_OR, EXPR_AND, EXPR_NOT */
+    path_expr *second;      /**< EXPR_OR, EXPR_AND */
+    path_operand left;      /**< EXPR_COMPARE, EXPR_EXISTS */
+    path_operand right;     /**< EXPR_COMPARE */
+};
+
+/**
+ * Compiled query plan, everything lives in one arena
+ */
+struct utjson_path
+{
+    utjson_arena *arena; /**< Storage of the plan */
+    path_step *steps;    /**< Segments after '$' */
+};
+
+/**
+ * Compiler state
+ */
+typedef struct
+{
+    const char *cursor;  /**< Next character of the query */
+    utjson_arena *arena; /**< Where the plan goes */
+} path_parser;
+
+/**
+ * Evaluation state
+ */
+typedef struct
+{
+    utjson *root;                 /**< Document the query started at ('$') */
+    utjson_path_callback callback; /**< Receives the matches */
+    void *user;                   /**< Callback context */
+} path_run;
+
+static void *path_alloc(path_parser *parser, size_t size)
+{
+    void *memory = utjson_arenaAlloc(parser->arena, size);
+    if (memory)
+    {
+        memset(memory, 0, size);
+    }
+    return memory;
+}
+
+static void skip_whitespace(path_parser *parser)
+{
+    while (is_json_whitespace(*parser->cursor))
+        parser->cursor++;
+}
+
+static bool accept(path_parser *parser, const char *token)
+{
+    size_t length = strlen(token);
+    if (strncmp(parser->cursor, token, length) != 0)
+        return false;
+    parser->cursor += length;
+    return true;
+}
+
+static path_expr *parse_or(path_parser *parser);
+
+/**
+ * Reads a '...' or "..." string literal into the arena, unescaped
+ */
+static char *parse_quoted(path_parser *parser)
+{
+    char quote = *parser->cursor++;
+    const char *start = parser->cursor;
+    while (*parser->cursor && *parser->cursor != quote)
+    {
+        parser->cursor += *parser->cursor == '\\' && parser->cursor[1] ? 2 : 1;
+    }
+    if (*parser->cursor != quote)
+        return NULL;
+
+    // escapes only ever shorten the text
+    char *text = utjson_arenaAlloc(parser->arena, parser->cursor - start + 1);
+    char *out = text;
+    for (const char *c = start; text && c < parser->cursor; c++)
+    {
+        if (*c != '\\')
+        {
+            *out++ = *c;
+            continue;
+        }
+        c++;
+        unsigned code;
+        switch (*c)
+        {
+        case 'b':
+            *out++ = '\b';
+            break;
+        case 'f':
+            *out++ = '\f';
+            break;
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 'r':
+            *out++ = '\r';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case '\\':
+        case '/':
+        case '"':
+        case '\'':
+            *out++ = *c;
+            break;
+        case 'u':
+            if (c + 4 >= parser->cursor || !utjson_hex4(c + 1, &code))
+                return NULL;
+            c += 4;
+            if (code >= 0xD800 && code < 0xDC00)
+            {
+                unsigned low;
+                if (c + 6 >= parser->cursor || c[1] != '\\' || c[2] != 'u' || !utjson_hex4(c + 3, &low) ||
+                    low < 0xDC00 || low > 0xDFFF)
+                    return NULL;
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                c += 6;
+            }
+            else if (code >= 0xDC00 && code <= 0xDFFF)
+            {
+                return NULL;
+            }
+            out = utjson_utf8Put(out, code);
+            break;
+        default:
+            return NULL;
+        }
+    }
+    parser->cursor++;
+    if (text)
+    {
+        *out = '\0';
+    }
+    return text;
+}
+
+static bool parse_integer(path_parser *parser, int64_t *value)
+{
+    bool negative = *parser->cursor == '-';
+    const char *digits = parser->cursor + negative;
+    if (!isdigit((unsigned char)*digits) || (digits[0] == '0' && isdigit((unsigned char)digits[1])))
+        return false;
+    uint64_t magnitude = 0;
+    for (; isdigit((unsigned char)*digits); digits++)
+    {
+        // checked before it is formed, so a long literal cannot wrap around
+        if (magnitude > ((uint64_t)INT64_MAX - (uint64_t)(*digits - '0')) / 10)
+            return false;
+        magnitude = magnitude * 10 + (uint64_t)(*digits - '0');
+    }
+    *value = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+    parser->cursor = digits;
+    return true;
+}
+
+static bool name_selector(path_selector *selector, char *name)
+{
+    if (!name)
+        return false;
+    selector->kind = SELECT_NAME;
+    selector->key = utjson_keyCompile(name);
+    return true;
+}
+
+/**
+ * Reads one selector inside brackets
+ */
+static path_selector *parse_selector(path_parser *parser)
+{
+    path_selector *selector = path_alloc(parser, sizeof(path_selector));
+    if (!selector)
+        return NULL;
+    char c = *parser->cursor;
+    if (c == '\'' || c == '"')
+        return name_selector(selector, parse_quoted(parser)) ? selector : NULL;
+    if (c == '*')
+    {
+        parser->cursor++;
+        selector->kind = SELECT_WILDCARD;
+        return selector;
+    }
+    if (c == '?')
+    {
+        parser->cursor++;
+        selector->kind = SELECT_FILTER;
+        selector->filter = parse_or(parser);
+        return selector->filter ? selector : NULL;
+    }
+
+    selector->has_start = c != ':';
+    if (selector->has_start && !parse_integer(parser, &selector->index))
+        return NULL;
+    skip_whitespace(parser);
+    if (*parser->cursor != ':')
+    {
+        selector->kind = SELECT_INDEX;
+        return selector->has_start ? selector : NULL;
+    }
+    parser->cursor++;
+    skip_whitespace(parser);
+    selector->kind = SELECT_SLICE;
+    selector->step = 1;
+    selector->has_end = *parser->cursor == '-' || isdigit((unsigned char)*parser->cursor);
+    if (selector->has_end && !parse_integer(parser, &selector->end))
+        return NULL;
+    skip_whitespace(parser);
+    if (accept(parser, ":"))
+    {
+        skip_whitespace(parser);
+        if ((*parser->cursor == '-' || isdigit((unsigned char)*parser->cursor)) &&
+            !parse_integer(parser, &selector->step))
+            return NULL;
+    }
+    return selector;
+}
+
+/**
+ * Reads the segments following '$' or '@'
+ *
+ * @param parser
+ * @param steps receives the first segment (NULL if there is none)
+ * @return true | false on a syntax error
+ */
+static bool parse_segments(path_parser *parser, path_step **steps)
+{
+    path_step **tail = steps;
+    *steps = NULL;
+    for (;;)
+    {
+        bool descendant = accept(parser, "..");
+        bool dotted = descendant || accept(parser, ".");
+        if (!dotted && *parser->cursor != '[')
+            return true;
+
+        path_step *step = path_alloc(parser, sizeof(path_step));
+        if (!step)
+            return false;
+        step->descendant = descendant;
+        // ".." may be followed by brackets, "." only by a name or '*'
+        if (*parser->cursor == '[' && (descendant || !dotted))
+        {
+            parser->cursor++;
+            path_selector **next = &step->selectors;
+            do
+            {
+                skip_whitespace(parser);
+                if (!(*next = parse_selector(parser)))
+                    return false;
+                next = &(*next)->next;
+                skip_whitespace(parser);
+            } while (accept(parser, ","));
+            if (!accept(parser, "]"))
+                return false;
+        }
+        else
+        {
+            path_selector *selector = path_alloc(parser, sizeof(path_selector));
+            if (!selector)
+                return false;
+            step->selectors = selector;
+            if (accept(parser, "*"))
+            {
+                selector->kind = SELECT_WILDCARD;
+            }
+            else
+            {
+                const char *start = parser->cursor;
+                if (!is_name_first(*start))
+                    return false;
+                while (is_name_char(*parser->cursor))
+                    parser->cursor++;
+                if (!name_selector(selector, utjson_arenaStrndup(parser->arena, start, parser->cursor - start)))
+                    return false;
+            }
+        }
+        *tail = step;
+        tail = &step->next;
+    }
+}
+
+// a query that can select at most one node
+static bool is_singular(const path_step *step)
+{
+    for (; step; step = step->next)
+    {
+        if (step->descendant || step->selectors->next ||
+            (step->selectors->kind != SELECT_NAME && step->selectors->kind != SELECT_INDEX))
+            return false;
+    }
+    return true;
+}
+
+static bool parse_operand(path_parser *parser, path_operand *operand)
+{
+    char c = *parser->cursor;
+    if (c == '@' || c == '$')
+    {
+        parser->cursor++;
+        operand->absolute = c == '$';
+        return parse_segments(parser, &operand->steps);
+    }
+    if (c == '\'' || c == '"')
+    {
+        char *text = parse_quoted(parser);
+        operand->literal = text ? utjson_createStringIn(parser->arena, NULL) : NULL;
+        if (operand->literal)
+        {
+            operand->literal->string = text;
+        }
+        return operand->literal != NULL;
+    }
+    if (accept(parser, "true") || accept(parser, "false"))
+    {
+        operand->literal = utjson_createBoolIn(parser->arena, parser->cursor[-1] == 'e' && parser->cursor[-2] == 'u');
+        return operand->literal != NULL;
+    }
+    if (accept(parser, "null"))
+    {
+        operand->literal = utjson_createNullIn(parser->arena);
+        return operand->literal != NULL;
+    }
+
+    utjson_number_token token;
+    size_t length = utjson_numberScan(parser->cursor, parser->cursor + strlen(parser->cursor), &token);
+    if (!length)
+        return false;
+    parser->cursor += length;
+    if (!token.integral)
+        operand->literal = utjson_createNumberIn(parser->arena, token.value);
+    else if (!token.negative)
+        operand->literal = utjson_createUint64In(parser->arena, token.magnitude);
+    else
+        operand->literal = utjson_createInt64In(parser->arena, (int64_t)(0 - token.magnitude));
+    return operand->literal != NULL;
+}
+
+static bool parse_compare(path_parser *parser, path_compare *op)
+{
+    static const struct
+    {
+        const char *token;
+        path_compare op;
+    } operators[] = {
+        {"==", COMPARE_EQUAL},      {"!=", COMPARE_NOT_EQUAL}, {"<=", COMPARE_LESS_EQUAL},
+        {">=", COMPARE_GREATER_EQUAL}, {"<", COMPARE_LESS},       {">", COMPARE_GREATER},
+    };
+    for (size_t i = 0; i < sizeof(operators) / sizeof(operators[0]); i++)
+    {
+        if (accept(parser, operators[i].token))
+        {
+            *op = operators[i].op;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * comparison := '(' or ')' | operand [op operand]
+ */
+static path_expr *parse_comparison(path_parser *parser)
+{
+    skip_whitespace(parser);
+    if (accept(parser, "("))
+    {
+        path_expr *inner = parse_or(parser);
+        skip_whitespace(parser);
+        return inner && accept(parser, ")") ? inner : NULL;
+    }
+
+    path_expr *expr = path_alloc(parser, sizeof(path_expr));
+    if (!expr || !parse_operand(parser, &expr->left))
+        return NULL;
+    skip_whitespace(parser);
+    if (!parse_compare(parser, &expr->op))
+    {
+        // a bare query tests for existence, a bare literal means nothing
+        expr->kind = EXPR_EXISTS;
+        return expr->left.literal ? NULL : expr;
+    }
+    expr->kind = EXPR_COMPARE;
+    skip_whitespace(parser);
+    if (!parse_operand(parser, &expr->right))
+        return NULL;
+    if ((!expr->left.literal && !is_singular(expr->left.steps)) ||
+        (!expr->right.literal && !is_singular(expr->right.steps)))
+        return NULL;
+    return expr;
+}
+
+static path_expr *parse_unary(path_parser *parser)
+{
+    skip_whitespace(parser);
+    if (*parser->cursor == '!' && parser->cursor[1] != '=')
+    {
+        parser->cursor++;
+        path_expr *expr = path_alloc(parser, sizeof(path_expr));
+        if (!expr || !(expr->first = parse_unary(parser)))
+            return NULL;
+        expr->kind = EXPR_NOT;
+        return expr;
+    }
+    return parse_comparison(parser);
+}
+
+static path_expr *parse_binary(path_parser *parser, path_expr_kind kind)
+{
+    path_expr *left = kind == EXPR_OR ? parse_binary(parser, EXPR_AND) : parse_unary(parser);
+    for (;;)
+    {
+        skip_whitespace(parser);
+        if (!left || !accept(parser, kind == EXPR_OR ? "||" : "&&"))
+            return left;
+        path_expr *expr = path_alloc(parser, sizeof(path_expr));
+        if (!expr)
+            return NULL;
+        expr->kind = kind;
+        expr->first = left;
+        expr->second = kind == EXPR_OR ? parse_binary(parser, EXPR_AND) : parse_unary(parser);
+        if (!expr->second)
+            return NULL;
+        left = expr;
+    }
+}
+
+static path_expr *parse_or(path_parser *parser)
+{
+    return parse_binary(parser, EXPR_OR);
+}
+
+/**
+ * Compiles a JSONPath query such as "$.items[?(@.price > 10)].id"
+ *
+ * @param query
+ * @return utjson_path*
+ */
+utjson_path *utjson_pathCompile(const char *query)
+{
+    if (!query)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    utjson_arena *arena = utjson_arenaCreate(1024);
+    utjson_path *path = arena ? utjson_arenaAlloc(arena, sizeof(utjson_path)) : NULL;
+    if (!path)
+    {
+        utjson_arenaDestroy(arena);
+        errno = ENOMEM;
+        return NULL;
+    }
+    path->arena = arena;
+
+    path_parser parser = {.cursor = query, .arena = arena};
+    skip_whitespace(&parser);
+    if (!accept(&parser, "$") || !parse_segments(&parser, &path->steps) ||
+        (skip_whitespace(&parser), *parser.cursor))
+    {
+        utjson_arenaDestroy(arena);
+        errno = EINVAL;
+        return NULL;
+    }
+    return path;
+}
+
+/**
+ * Destroys a compiled query
+ *
+ * @param path
+ * @return utjson_path*
+ */
+utjson_path *utjson_pathDestroy(utjson_path *path)
+{
+    if (path)
+    {
+        utjson_arenaDestroy(path->arena);
+    }
+    return NULL;
+}
+
+static bool path_walk(const path_run *run, const path_step *step, utjson *node);
+static bool expr_holds(const path_run *run, const path_expr *expr, utjson *current);
+
+// array index from a possibly negative one, -1 when out of range
+static int64_t index_normalize(int64_t index, size_t length)
+{
+    if (index < 0)
+    {
+        index += (int64_t)length;
+    }
+    return index >= 0 && (uint64_t)index < length ? index : -1;
+}
+
+static int64_t clamp(int64_t value, int64_t low, int64_t high)
+{
+    return value < low ? low : value > high ? high : value;
+}
+
+static bool select_slice(const path_run *run, const path_step *step, const path_selector *selector, utjson *array)
+{
+    int64_t length = (int64_t)array->used;
+    int64_t start = selector->index < 0 ? selector->index + length : selector->index;
+    int64_t end = selector->end < 0 ? selector->end + length : selector->end;
+    if (selector->step > 0)
+    {
+        int64_t lower = selector->has_start ? clamp(start, 0, length) : 0;
+        int64_t upper = selector->has_end ? clamp(end, 0, length) : length;
+        // the next index is checked before it is formed, so a huge step cannot overflow
+        for (int64_t i = lower; i < upper; i = selector->step < upper - i ? i + selector->step : upper)
+        {
+            if (!path_walk(run, step->next, array->children[i]))
+                return false;
+        }
+    }
+    else if (selector->step < 0)
+    {
+        int64_t upper = selector->has_start ? clamp(start, -1, length - 1) : length - 1;
+        int64_t lower = selector->has_end ? clamp(end, -1, length - 1) : -1;
+        for (int64_t i = upper; lower < i; i = selector->step > lower - i ? i + selector->step : lower)
+        {
+            if (!path_walk(run, step->next, array->children[i]))
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Passes the children of node the step selects on to the next step
+ *
+ * @return false once the callback stopped
+ */
+static bool path_select(const path_run *run, const path_step *step, utjson *node)
+{
+    bool container = utjson_IS(ARRAY, node) || utjson_IS(OBJECT, node);
+    for (const path_selector *selector = step->selectors; selector; selector = selector->next)
+    {
+        switch (selector->kind)
+        {
+        case SELECT_NAME:
+            if (utjson_IS(OBJECT, node))
+            {
+                utjson *child = utjson_getByKey(node, &selector->key);
+                if (child && !path_walk(run, step->next, child))
+                    return false;
+            }
+            break;
+        case SELECT_INDEX:
+            if (utjson_IS(ARRAY, node))
+            {
+                int64_t index = index_normalize(selector->index, node->used);
+                if (index >= 0 && !path_walk(run, step->next, node->children[index]))
+                    return false;
+            }
+            break;
+        case SELECT_SLICE:
+            if (utjson_IS(ARRAY, node) && !select_slice(run, step, selector, node))
+                return false;
+            break;
+        case SELECT_WILDCARD:
+        case SELECT_FILTER:
+            for (size_t i = 0; container && i < node->used; i++)
+            {
+                utjson *child = node->children[i];
+                if ((selector->kind == SELECT_WILDCARD || expr_holds(run, selector->filter, child)) &&
+                    !path_walk(run, step->next, child))
+                    return false;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+/**
+ * Applies the steps from step on to node, reporting the matches
+ *
+ * @return false once the callback stopped
+ */
+static bool path_walk(const path_run *run, const path_step *step, utjson *node)
+{
+    if (!step)
+        return run->callback(run->user, node);
+    if (!path_select(run, step, node))
+        return false;
+    if (step->descendant && (utjson_IS(ARRAY, node) || utjson_IS(OBJECT, node)))
+    {
+        for (size_t i = 0; i < node->used; i++)
+        {
+            if (!path_walk(run, step, node->children[i]))
+                return false;
+        }
+    }
+    return true;
+}
+
+// the node a singular query names, NULL if there is none
+static utjson *operand_value(const path_run *run, const path_operand *operand, utjson *current)
+{
+    if (operand->literal)
+        return operand->literal;
+    utjson *node = operand->absolute ? run->root : current;
+    for (const path_step *step = operand->steps; node && step; step = step->next)
+    {
+        const path_selector *selector = step->selectors;
+        if (selector->kind == SELECT_NAME)
+        {
+            node = utjson_IS(OBJECT, node) ? utjson_getByKey(node, &selector->key) : NULL;
+        }
+        else
+        {
+            int64_t index = utjson_IS(ARRAY, node) ? index_normalize(selector->index, node->used) : -1;
+            node = index >= 0 ? node->children[index] : NULL;
+        }
+    }
+    return node;
+}
+
+static int number_order(const utjson *a, const utjson *b)
+{
+    if (a->flags & b->flags & utjson_INTEGER)
+    {
+        bool a_negative = !(a->flags & utjson_UNSIGNED) && a->integer < 0;
+        bool b_negative = !(b->flags & utjson_UNSIGNED) && b->integer < 0;
+        if (a_negative != b_negative)
+            return a_negative ? -1 : 1;
+        // same sign: two's complement keeps the order of the bit patterns
+        return a->uinteger < b->uinteger ? -1 : a->uinteger > b->uinteger;
+    }
+    double x = utjson_asNumber((utjson *)a);
+    double y = utjson_asNumber((utjson *)b);
+    return x < y ? -1 : x > y;
+}
+
+static bool node_equal(const utjson *a, const utjson *b)
+{
+    if (!a || !b)
+        return a == b;
+    if (a->type != b->type)
+        return false;
+    switch (a->type)
+    {
+    case utjson_NULL:
+        return true;
+    case utjson_BOOL:
+        return utjson_asBool((utjson *)a) == utjson_asBool((utjson *)b);
+    case utjson_NUMBER:
+        return number_order(a, b) == 0;
+    case utjson_STRING:
+        return a->string && b->string ? strcmp(a->string, b->string) == 0 : a->string == b->string;
+    case utjson_ARRAY:
+        if (a->used != b->used)
+            return false;
+        for (size_t i = 0; i < a->used; i++)
+        {
+            if (!node_equal(a->children[i], b->children[i]))
+                return false;
+        }
+        return true;
+    case utjson_OBJECT:
+        if (a->used != b->used)
+            return false;
+        for (size_t i = 0; i < a->used; i++)
+        {
+            if (!node_equal(a->children[i], utjson_get((utjson *)b, a->children[i]->name)))
+                return false;
+        }
+        return true;
+    default:
+        return a->pointer == b->pointer;
+    }
+}
+
+// a < b, only numbers and strings are ordered
+static bool node_less(const utjson *a, const utjson *b)
+{
+    if (!a || !b || a->type != b->type)
+        return false;
+    if (a->type == utjson_NUMBER)
+        return number_order(a, b) < 0;
+    if (a->type == utjson_STRING && a->string && b->string)
+        return strcmp(a->string, b->string) < 0;
+    return false;
+}
+
+static bool found_one(void *user, utjson *match)
+{
+    (void)match;
+    *(bool *)user = true;
+    return false;
+}
+
+static bool expr_holds(const path_run *run, const path_expr *expr, utjson *current)
+{
+    switch (expr->kind)
+    {
+    case EXPR_OR:
+        return expr_holds(run, expr->first, current) || expr_holds(run, expr->second, current);
+    case EXPR_AND:
+        return expr_holds(run, expr->first, current) && expr_holds(run, expr->second, current);
+    case EXPR_NOT:
+        return !expr_holds(run, expr->first, current);
+    case EXPR_EXISTS:
+    {
+        bool found = false;
+        path_run probe = {.root = run->root, .callback = found_one, .user = &found};
+        path_walk(&probe, expr->left.steps, expr->left.absolute ? run->root : current);
+        return found;
+    }
+    case EXPR_COMPARE:
+        break;
+    }
+
+    utjson *a = operand_value(run, &expr->left, current);
+    utjson *b = operand_value(run, &expr->right, current);
+    switch (expr->op)
+    {
+    case COMPARE_EQUAL:
+        return node_equal(a, b);
+    case COMPARE_NOT_EQUAL:
+        return !node_equal(a, b);
+    case COMPARE_LESS:
+        return node_less(a, b);
+    case COMPARE_LESS_EQUAL:
+        return node_less(a, b) || node_equal(a, b);
+    case COMPARE_GREATER:
+        return node_less(b, a);
+    case COMPARE_GREATER_EQUAL:
+        return node_less(b, a) || node_equal(a, b);
+    }
+    return false;
+}
+
+/**
+ * Runs a compiled query, passing every match to the callback in document order
+ *
+ * @param root
+ * @param path
+ * @param callback
+ * @param user
+ * @return true | false if the callback stopped the query
+ */
+bool utjson_pathEach(utjson *root, const utjson_path *path, utjson_path_callback callback, void *user)
+{
+    if (!root || !path || !callback)
+    {
+        errno = EINVAL;
+        return false;
+    }
+    path_run run = {.root = root, .callback = callback, .user = user};
+    if (!path_walk(&run, path->steps, root))
+    {
+        errno = ECANCELED;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Growable list of matches
+ */
+typedef struct
+{
+    utjson **matches;
+    size_t count;
+    size_t allocated;
+} path_matches;
+
+static bool collect_match(void *user, utjson *match)
+{
+    path_matches *list = user;
+    if (list->count + 1 >= list->allocated)
+    {
+        size_t allocated = list->allocated * 2;
+        utjson **matches = realloc(list->matches, allocated * sizeof(utjson *));
+        if (!matches)
+            return false;
+        list->matches = matches;
+        list->allocated = allocated;
+    }
+    list->matches[list->count++] = match;
+    return true;
+}
+
+/**
+ * Runs a compiled query and returns its matches
+ *
+ * @param root
+ * @param path
+ * @param count
+ * @return utjson** NULL-terminated array of borrowed nodes, to be freed with free()
+ */
+utjson **utjson_pathSelect(utjson *root, const utjson_path *path, size_t *count)
+{
+    path_matches list = {.matches = malloc(utjson_ARRAY_INCREMENT * sizeof(utjson *)),
+                         .allocated = utjson_ARRAY_INCREMENT};
+    if (!list.matches)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (!utjson_pathEach(root, path, collect_match, &list))
+    {
+        if (errno == ECANCELED)
+        {
+            errno = ENOMEM;
+        }
+        free(list.matches);
+        return NULL;
+    }
+    list.matches[list.count] = NULL;
+    if (count)
+    {
+        *count = list.count;
+    }
+    return list.matches;
+}
@@ -0,0 +1,220 @@
+#include "utjson_internal.h"
+#include <errno.h>
+
+#define POINTER_NO_INDEX SIZE_MAX /**< The segment is not an array index */
+#define POINTER_END (SIZE_MAX - 1) /**< The segment is "-", one past the last element */
+
+/**
+ * One reference token of a compiled pointer
+ */
+typedef struct
+{
+    utjson_key key; /**< Unescaped token as a member name */
+    size_t index;   /**< Token as an array index, POINTER_NO_INDEX or POINTER_END */
+} pointer_segment;
+
+/**
+ * Compiled JSON Pointer: the segments, followed by their unescaped names
+ */
+struct utjson_pointer
+{
+    size_t count;               /**< Number of segments, 0 for the whole document */
+    pointer_segment segments[]; /**< Segments from the root down */
+};
+
+// decimal index without leading zeros, as RFC 6901 requires
+static size_t segment_index(const char *token, size_t length)
+{
+    if (length == 1 && token[0] == '-')
+        return POINTER_END;
+    if (!length || length > 19 || (token[0] == '0' && length > 1))
+        return POINTER_NO_INDEX;
+    size_t index = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (token[i] < '0' || token[i] > '9')
+            return POINTER_NO_INDEX;
+        index = index * 10 + (size_t)(token[i] - '0');
+    }
+    return index < POINTER_END ? index : POINTER_NO_INDEX;
+}
+
+/**
+ * Compiles a JSON Pointer (RFC 6901) such as "/a/b/3/c"
+ *
+ * @param text
+ * @return utjson_pointer*
+ */
+utjson_pointer *utjson_pointerCompile(const char *text)
+{
+    if (!text || (*text && *text != '/'))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    size_t count = 0;
+    for (const char *c = text; *c; c++)
+    {
+        count += *c == '/';
+    }
+    // unescaping only shortens the tokens, each gets its own terminator
+    size_t length = strlen(text);
+    utjson_pointer *pointer = malloc(sizeof(utjson_pointer) + count * sizeof(pointer_segment) + length + 1);
+    if (!pointer)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    pointer->count = count;
+
+    char *names = (char *)&pointer->segments[count];
+    const char *c = text;
+    for (size_t i = 0; i < count; i++)
+    {
+        char *name = names;
+        for (c++; *c && *c != '/'; c++)
+        {
+            if (*c == '~')
+            {
+                c++;
+                if (*c != '0' && *c != '1')
+                {
+                    free(pointer);
+                    errno = EINVAL;
+                    return NULL;
+                }
+                *names++ = *c == '0' ? '~' : '/';
+            }
+            else
+            {
+                *names++ = *c;
+            }
+        }
+        *names++ = '\0';
+        pointer->segments[i].key = utjson_keyCompile(name);
+        pointer->segments[i].index = segment_index(name, names - name - 1);
+    }
+    return pointer;
+}
+
+/**
+ * Destroys a compiled pointer
+ *
+ * @param pointer
+ * @return utjson_pointer*
+ */
+utjson_pointer *utjson_pointerDestroy(utjson_pointer *pointer)
+{
+    free(pointer);
+    return NULL;
+}
+
+// the child a segment names, NULL if there is none
+static utjson *pointer_step(utjson *node, const pointer_segment *segment)
+{
+    if (utjson_IS(OBJECT, node))
+        return utjson_getByKey(node, &segment->key);
+    if (utjson_IS(ARRAY, node) && segment->index < node->used)
+        return node->children[segment->index];
+    return NULL;
+}
+
+/**
+ * Resolves a compiled pointer against a document
+ *
+ * @param root
+ * @param pointer
+ * @return utjson* or NULL if the value does not exist
+ */
+utjson *utjson_pointerGet(utjson *root, const utjson_pointer *pointer)
+{
+    if (!pointer)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    utjson *node = root;
+    for (size_t i = 0; node && i < pointer->count; i++)
+    {
+        node = pointer_step(node, &pointer->segments[i]);
+    }
+    return node;
+}
+
+/**
+ * Stores object at the place a compiled pointer names
+ *
+ * @param root
+ * @param pointer
+ * @param object
+ * @return utjson*
+ */
+utjson *utjson_pointerSet(utjson *root, const utjson_pointer *pointer, utjson *object)
+{
+    if (!pointer || !pointer->count)
+    {
+        // the root cannot be replaced in place
+        errno = EINVAL;
+        return NULL;
+    }
+    utjson *parent = root;
+    for (size_t i = 0; parent && i + 1 < pointer->count; i++)
+    {
+        parent = pointer_step(parent, &pointer->segments[i]);
+    }
+
+    const pointer_segment *last = &pointer->segments[pointer->count - 1];
+    if (utjson_IS(OBJECT, parent))
+        return utjson_setByKey(parent, &last->key, object);
+    if (!utjson_IS(ARRAY, parent) || (last->index > parent->used && last->index != POINTER_END))
+    {
+        errno = parent ? EINVAL : ENOENT;
+        return NULL;
+    }
+    if (last->index >= parent->used)
+        return utjson_add(parent, object);
+
+    if (!object)
+    {
+        object = utjson_createNullIn(parent->arena);
+        if (!object)
+            return NULL;
+    }
+    utjson *replaced = parent->children[last->index];
+    if (replaced != object)
+    {
+        parent->children[last->index] = object;
+        object->parent = parent;
+        utjson_destruct(replaced);
+    }
+    return object;
+}
+
+/**
+ * Number of reference tokens of a compiled pointer
+ *
+ * @param pointer
+ * @return size_t
+ */
+size_t utjson_pointerLength(const utjson_pointer *pointer)
+{
+    return pointer->count;
+}
+
+/**
+ * Reference token at depth of a compiled pointer
+ *
+ * @param pointer
+ * @param depth
+ * @param index receives the token as an array index, SIZE_MAX if it is none (may be NULL)
+ * @return const utjson_key*
+ */
+const utjson_key *utjson_pointerToken(const utjson_pointer *pointer, size_t depth, size_t *index)
+{
+    const pointer_segment *segment = &pointer->segments[depth];
+    if (index)
+    {
+        *index = segment->index == POINTER_END ? POINTER_NO_INDEX : segment->index;
+    }
+    return &segment->key;
+}
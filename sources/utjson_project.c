@@ -0,0 +1,410 @@
+#include "utjson_internal.h"
+#include <ctype.h>
+#include <errno.h>
+
+#define PROJECT_LOCAL 16 /**< Pointers tracked on the stack per level */
+#define SKIP_LOCAL 64    /**< Nesting skipped before the bracket stack is allocated */
+
+/**
+ * Projection state
+ */
+typedef struct
+{
+    parse_context ctx;                  /**< Parser of the selected values */
+    const utjson_pointer *const *pointers; /**< What to keep */
+} project_state;
+
+static void skip_whitespace(parse_context *ctx)
+{
+    while (ctx->cursor < ctx->end && isspace((unsigned char)*ctx->cursor))
+        ctx->cursor++;
+}
+
+// steps over a string, literal or number
+static bool skip_scalar(parse_context *ctx)
+{
+    char *c = ctx->cursor;
+    if (*c == '"')
+    {
+        c = utjson_stringEnd(c + 1, ctx->end);
+        ctx->cursor = c ? c + 1 : ctx->cursor;
+        return c != NULL;
+    }
+    size_t left = ctx->end - c;
+    size_t length = 0;
+    if (left >= 4 && (memcmp(c, "null", 4) == 0 || memcmp(c, "true", 4) == 0))
+    {
+        length = 4;
+    }
+    else if (left >= 5 && memcmp(c, "false", 5) == 0)
+    {
+        length = 5;
+    }
+    else
+    {
+        utjson_number_token token;
+        length = utjson_numberScan(c, ctx->end, &token);
+    }
+    ctx->cursor += length;
+    return length != 0;
+}
+
+// steps over a member key and its colon
+static bool skip_key(parse_context *ctx)
+{
+    skip_whitespace(ctx);
+    char *quote =
+        ctx->cursor < ctx->end && *ctx->cursor == '"' ? utjson_stringEnd(ctx->cursor + 1, ctx->end) : NULL;
+    if (!quote)
+        return false;
+    ctx->cursor = quote + 1;
+    skip_whitespace(ctx);
+    if (ctx->cursor >= ctx->end || *ctx->cursor != ':')
+        return false;
+    ctx->cursor++;
+    return true;
+}
+
+/**
+ * Steps over the value at the cursor without building it
+ *
+ * Checked as strictly as the parsers do: every container is closed by its own
+ * bracket and its members or elements are separated by commas.
+ */
+static bool skip_value(parse_context *ctx)
+{
+    // the closing bracket of every open container
+    char local[SKIP_LOCAL];
+    char *closers = local;
+    size_t depth = 0;
+    size_t allocated = SKIP_LOCAL;
+    bool skipped = false;
+
+    for (;;)
+    {
+        skip_whitespace(ctx);
+        if (ctx->cursor >= ctx->end)
+            break;
+        char c = *ctx->cursor;
+        if (c == '[' || c == '{')
+        {
+            if (depth == allocated)
+            {
+                char *grown = realloc(closers == local ? NULL : closers, allocated * 2);
+                if (!grown)
+                {
+                    errno = ENOMEM;
+                    break;
+                }
+                if (closers == local)
+                {
+                    memcpy(grown, local, depth);
+                }
+                closers = grown;
+                allocated *= 2;
+            }
+            closers[depth++] = c == '[' ? ']' : '}';
+            ctx->cursor++;
+            skip_whitespace(ctx);
+            if (ctx->cursor < ctx->end && *ctx->cursor == closers[depth - 1])
+            {
+                ctx->cursor++;
+                depth--;
+            }
+            else if (c == '[' || skip_key(ctx))
+            {
+                continue; // the first element or member value
+            }
+            else
+            {
+                break;
+            }
+        }
+        else if (!skip_scalar(ctx))
+        {
+            break;
+        }
+
+        // a value is followed by ',' and the next one, or by the bracket of its container
+        bool separated = false;
+        while (depth && !separated)
+        {
+            skip_whitespace(ctx);
+            char next = ctx->cursor < ctx->end ? *ctx->cursor : '\0';
+            if (next == closers[depth - 1])
+            {
+                ctx->cursor++;
+                depth--;
+                continue;
+            }
+            if (next != ',')
+                break;
+            ctx->cursor++;
+            separated = closers[depth - 1] == ']' || skip_key(ctx);
+            if (!separated)
+                break;
+        }
+        if (!separated)
+        {
+            skipped = !depth;
+            break;
+        }
+    }
+    if (closers != local)
+    {
+        free(closers);
+    }
+    return skipped;
+}
+
+static bool project_value(project_state *state, const size_t *active, size_t count, size_t depth, utjson **result);
+
+/**
+ * Handles one member or element whose pointers are in next
+ *
+ * @return false on malformed input
+ */
+static bool project_child(project_state *state, const size_t *next, size_t count, size_t depth, utjson **child)
+{
+    *child = NULL;
+    if (!count)
+        return skip_value(&state->ctx);
+    for (size_t i = 0; i < count; i++)
+    {
+        // a pointer ending here keeps the whole value
+        if (utjson_pointerLength(state->pointers[next[i]]) == depth + 1)
+            return (*child = utjson_parseValue(&state->ctx)) != NULL;
+    }
+    return project_value(state, next, count, depth + 1, child);
+}
+
+static bool project_object(project_state *state, const size_t *active, size_t count, size_t depth, size_t *next,
+                           utjson *object)
+{
+    parse_context *ctx = &state->ctx;
+    ctx->cursor++;
+    skip_whitespace(ctx);
+    if (ctx->cursor < ctx->end && *ctx->cursor == '}')
+    {
+        ctx->cursor++;
+        return true;
+    }
+    for (;;)
+    {
+        skip_whitespace(ctx);
+        char *quote =
+            ctx->cursor < ctx->end && *ctx->cursor == '"' ? utjson_stringEnd(ctx->cursor + 1, ctx->end) : NULL;
+        if (!quote)
+            return false;
+        char *start = ctx->cursor + 1;
+        size_t length = quote - start;
+        ctx->cursor = quote + 1;
+        skip_whitespace(ctx);
+        if (ctx->cursor >= ctx->end || *ctx->cursor != ':')
+            return false;
+        ctx->cursor++;
+
+        // the tokens are unescaped, so are the keys that contain escapes
+        const char *text = start;
+        size_t text_length = length;
+        if (memchr(start, '\\', length))
+        {
+            text = utjson_parseKey(ctx, start, length);
+            if (!text)
+                return false;
+            text_length = strlen(text);
+        }
+        size_t matched = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const utjson_key *key = utjson_pointerToken(state->pointers[active[i]], depth, NULL);
+            if (key->length == text_length && memcmp(key->name, text, text_length) == 0)
+            {
+                next[matched++] = active[i];
+            }
+        }
+        utjson *child;
+        if (!project_child(state, next, matched, depth, &child))
+            return false;
+        if (child)
+        {
+            // nested members reuse the scratch, so the key is built only now
+            char *name = utjson_parseKey(ctx, start, length);
+            if (!name || !utjson_setMember(object, name, child, ctx->in_place ? utjson_BORROWED_NAME : 0))
+            {
+                utjson_destruct(child);
+                return false;
+            }
+        }
+
+        // a comma leads to the next one, anything but the closing bracket is malformed
+        skip_whitespace(ctx);
+        char next = ctx->cursor < ctx->end ? *ctx->cursor++ : '\0';
+        if (next == '}')
+            return true;
+        if (next != ',')
+            return false;
+    }
+}
+
+static bool project_array(project_state *state, const size_t *active, size_t count, size_t depth, size_t *next,
+                          utjson *array)
+{
+    parse_context *ctx = &state->ctx;
+    ctx->cursor++;
+    skip_whitespace(ctx);
+    if (ctx->cursor < ctx->end && *ctx->cursor == ']')
+    {
+        ctx->cursor++;
+        return true;
+    }
+    for (size_t index = 0;; index++)
+    {
+        size_t matched = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t wanted;
+            utjson_pointerToken(state->pointers[active[i]], depth, &wanted);
+            if (wanted == index)
+            {
+                next[matched++] = active[i];
+            }
+        }
+        utjson *child;
+        if (!project_child(state, next, matched, depth, &child))
+            return false;
+        if (child)
+        {
+            // skipped elements before it stay as null, so the pointers resolve as in the document
+            while (array->used < index)
+            {
+                if (!utjson_add(array, utjson_createNullIn(array->arena)))
+                {
+                    utjson_destruct(child);
+                    return false;
+                }
+            }
+            if (!utjson_add(array, child))
+            {
+                utjson_destruct(child);
+                return false;
+            }
+        }
+
+        // a comma leads to the next one, anything but the closing bracket is malformed
+        skip_whitespace(ctx);
+        char next = ctx->cursor < ctx->end ? *ctx->cursor++ : '\0';
+        if (next == ']')
+            return true;
+        if (next != ',')
+            return false;
+    }
+}
+
+/**
+ * Builds the parts of the value at the cursor that the active pointers reach below depth
+ *
+ * @param state
+ * @param active pointers that continue past depth
+ * @param count
+ * @param depth
+ * @param result receives the projection, NULL if nothing is left
+ * @return false on malformed input
+ */
+static bool project_value(project_state *state, const size_t *active, size_t count, size_t depth, utjson **result)
+{
+    parse_context *ctx = &state->ctx;
+    *result = NULL;
+    skip_whitespace(ctx);
+    char c = ctx->cursor < ctx->end ? *ctx->cursor : '\0';
+    if (c != '{' && c != '[')
+        return skip_value(ctx); // the pointers go deeper than a scalar
+
+    size_t local[PROJECT_LOCAL];
+    size_t *next = count <= PROJECT_LOCAL ? local : malloc(count * sizeof(size_t));
+    utjson *container = c == '{' ? utjson_createObjectIn(ctx->arena) : utjson_createArrayIn(ctx->arena);
+    bool parsed = next && container &&
+                  (c == '{' ? project_object(state, active, count, depth, next, container)
+                            : project_array(state, active, count, depth, next, container));
+    if (next != local)
+    {
+        free(next);
+    }
+    if (!parsed)
+    {
+        utjson_destruct(container);
+        return false;
+    }
+    // branches without a match are pruned, the root is always kept
+    if (depth && !container->used)
+    {
+        container = utjson_destruct(container);
+    }
+    *result = container;
+    return true;
+}
+
+/**
+ * Parses only the parts of a document the pointers name
+ *
+ * @param source
+ * @param length
+ * @param pointers
+ * @param count
+ * @param flags
+ * @return utjson*
+ */
+utjson *utjson_parseProjected(char *source, size_t length, const utjson_pointer *const *pointers, size_t count,
+                              unsigned flags)
+{
+    if (!source || (!pointers && count))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    size_t *active = malloc((count ? count : 1) * sizeof(size_t));
+    if (!active)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    bool whole = false;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!pointers[i])
+        {
+            free(active);
+            errno = EINVAL;
+            return NULL;
+        }
+        // "" is the whole document
+        whole = whole || !utjson_pointerLength(pointers[i]);
+        active[i] = i;
+    }
+
+    project_state state = {
+        .ctx =
+            {
+                .cursor = source,
+                .end = source + length,
+                .in_place = flags & utjson_PARSE_IN_PLACE,
+                .integers = flags & utjson_PARSE_INTEGERS,
+                .validate_utf8 = flags & utjson_PARSE_VALIDATE_UTF8,
+            },
+        .pointers = pointers,
+    };
+    utjson *root = NULL;
+    bool parsed = whole ? (root = utjson_parseValue(&state.ctx)) != NULL
+                        : project_value(&state, active, count, 0, &root);
+    // only whitespace may follow the document
+    skip_whitespace(&state.ctx);
+    if (!parsed || !root || state.ctx.cursor != state.ctx.end)
+    {
+        utjson_destruct(root);
+        root = NULL;
+        errno = EINVAL;
+    }
+    utjson_bufferFree(&state.ctx.scratch);
+    free(active);
+    return root;
+}
@@ -0,0 +1,268 @@
+#include "utjson_internal.h"
+#include "utjson_simd.h"
+#include <errno.h>
+
+#define is_json_whitespace(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+
+/**
+ * What the event parser expects from the next structural character
+ */
+typedef enum
+{
+    EXPECT_VALUE,        /**< Any value */
+    EXPECT_VALUE_OR_END, /**< First element of an array or ']' */
+    EXPECT_KEY,          /**< Member key */
+    EXPECT_KEY_OR_END,   /**< First member key of an object or '}' */
+    EXPECT_SEPARATOR,    /**< ',' or the end of the current container */
+} sax_expect;
+
+/**
+ * Event parser state
+ */
+typedef struct
+{
+    utjson_structural index; /**< Stage one of the indexed parser */
+    const char *source;      /**< Parsed input */
+    size_t length;           /**< Input length */
+    const utjson_sax *sax;   /**< Callbacks */
+    void *user;              /**< Callback context */
+    char local[256];         /**< Container kinds ('[' or '{'), innermost last */
+    char *kinds;             /**< local, or a heap copy for deep documents */
+    size_t depth;            /**< Number of open containers */
+    size_t allocated;        /**< Capacity of kinds */
+    size_t muted;            /**< Depth of the container being skipped, SIZE_MAX if none */
+} sax_context;
+
+// skipped containers are parsed as strictly as the rest, only without events
+#define SAX_EMIT(ctx, callback, ...)                                            \
+    ((ctx)->depth < (ctx)->muted && (ctx)->sax->callback                        \
+         ? (ctx)->sax->callback((ctx)->user, ##__VA_ARGS__)                     \
+         : utjson_SAX_CONTINUE)
+
+static bool sax_push(sax_context *ctx, char kind)
+{
+    if (ctx->depth == ctx->allocated)
+    {
+        size_t allocated = ctx->allocated * 2;
+        char *kinds = ctx->kinds == ctx->local ? malloc(allocated) : realloc(ctx->kinds, allocated);
+        if (!kinds)
+        {
+            errno = ENOMEM;
+            return false;
+        }
+        if (ctx->kinds == ctx->local)
+        {
+            memcpy(kinds, ctx->local, ctx->depth);
+        }
+        ctx->kinds = kinds;
+        ctx->allocated = allocated;
+    }
+    ctx->kinds[ctx->depth++] = kind;
+    return true;
+}
+
+// closes the innermost container; closing the skipped one ends the skip without an event
+static utjson_sax_action sax_close(sax_context *ctx)
+{
+    char kind = ctx->kinds[ctx->depth - 1];
+    utjson_sax_action action = kind == '[' ? SAX_EMIT(ctx, end_array) : SAX_EMIT(ctx, end_object);
+    if (ctx->depth-- == ctx->muted)
+    {
+        ctx->muted = SIZE_MAX;
+    }
+    return action;
+}
+
+static bool sax_atom(sax_context *ctx, size_t position, bool emit, utjson_sax_action *action)
+{
+    const char *start = ctx->source + position;
+    size_t available = ctx->length - position;
+    size_t used = 0;
+    double number = 0;
+    enum { ATOM_NULL, ATOM_TRUE, ATOM_FALSE, ATOM_NUMBER } atom;
+
+    if (available >= 4 && memcmp(start, "null", 4) == 0)
+    {
+        used = 4;
+        atom = ATOM_NULL;
+    }
+    else if (available >= 4 && memcmp(start, "true", 4) == 0)
+    {
+        used = 4;
+        atom = ATOM_TRUE;
+    }
+    else if (available >= 5 && memcmp(start, "false", 5) == 0)
+    {
+        used = 5;
+        atom = ATOM_FALSE;
+    }
+    else if (*start == '-' || (*start >= '0' && *start <= '9'))
+    {
+        parse_context scan = {.cursor = (char *)start, .end = (char *)ctx->source + ctx->length};
+        if (!utjson_parseNumber(&scan, &number))
+            return false;
+        used = scan.cursor - start;
+        atom = ATOM_NUMBER;
+    }
+    else
+    {
+        return false;
+    }
+
+    // a literal or number has to end right at a delimiter
+    if (used < available && !is_json_whitespace(start[used]) && !memchr(",:]}[{\"", start[used], 7))
+        return false;
+
+    if (!emit)
+        return true;
+    switch (atom)
+    {
+    case ATOM_NULL:
+        *action = SAX_EMIT(ctx, null);
+        break;
+    case ATOM_TRUE:
+    case ATOM_FALSE:
+        *action = SAX_EMIT(ctx, boolean, atom == ATOM_TRUE);
+        break;
+    case ATOM_NUMBER:
+        *action = SAX_EMIT(ctx, number, number);
+        break;
+    }
+    return true;
+}
+
+static bool sax_run(sax_context *ctx)
+{
+    sax_expect expect = EXPECT_VALUE;
+    bool skip_value = false;
+    size_t position;
+
+    while ((position = utjson_structuralNext(&ctx->index)) != SIZE_MAX)
+    {
+        char c = ctx->source[position];
+        char kind = ctx->depth ? ctx->kinds[ctx->depth - 1] : 0;
+        utjson_sax_action action = utjson_SAX_CONTINUE;
+
+        if (expect == EXPECT_SEPARATOR)
+        {
+            if (!kind)
+                return true; // trailing content after the document is ignored
+            if (c == ',')
+            {
+                expect = kind == '[' ? EXPECT_VALUE : EXPECT_KEY;
+                continue;
+            }
+            if (c != (kind == '[' ? ']' : '}'))
+                break;
+            action = sax_close(ctx);
+        }
+        else if ((expect == EXPECT_KEY_OR_END && c == '}') || (expect == EXPECT_VALUE_OR_END && c == ']'))
+        {
+            expect = EXPECT_SEPARATOR;
+            action = sax_close(ctx);
+        }
+        else if (expect == EXPECT_KEY || expect == EXPECT_KEY_OR_END)
+        {
+            size_t closing = utjson_structuralNext(&ctx->index);
+            size_t colon = utjson_structuralNext(&ctx->index);
+            if (c != '"' || closing == SIZE_MAX || ctx->source[closing] != '"' ||
+                colon == SIZE_MAX || ctx->source[colon] != ':')
+                break;
+            expect = EXPECT_VALUE;
+            action = SAX_EMIT(ctx, key, ctx->source + position + 1, closing - position - 1);
+            skip_value = action == utjson_SAX_SKIP;
+        }
+        else if (c == '{' || c == '[')
+        {
+            if (!skip_value)
+            {
+                action = c == '{' ? SAX_EMIT(ctx, start_object) : SAX_EMIT(ctx, start_array);
+            }
+            if (action != utjson_SAX_ABORT)
+            {
+                if (!sax_push(ctx, c))
+                    return false;
+                if ((skip_value || action == utjson_SAX_SKIP) && ctx->muted == SIZE_MAX)
+                {
+                    ctx->muted = ctx->depth;
+                }
+                skip_value = false;
+                action = utjson_SAX_CONTINUE;
+                expect = c == '{' ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END;
+            }
+        }
+        else if (c == '"')
+        {
+            size_t closing = utjson_structuralNext(&ctx->index);
+            if (closing == SIZE_MAX || ctx->source[closing] != '"')
+                break; // Unterminated string
+            expect = EXPECT_SEPARATOR;
+            if (!skip_value)
+            {
+                action = SAX_EMIT(ctx, string, ctx->source + position + 1, closing - position - 1);
+            }
+            skip_value = false;
+        }
+        else if (c == ']' || c == '}' || c == ',' || c == ':')
+        {
+            break;
+        }
+        else
+        {
+            expect = EXPECT_SEPARATOR;
+            if (!sax_atom(ctx, position, !skip_value, &action))
+                break;
+            skip_value = false;
+        }
+
+        if (action == utjson_SAX_ABORT)
+        {
+            errno = ECANCELED;
+            return false;
+        }
+    }
+
+    if (position == SIZE_MAX && !ctx->depth && expect == EXPECT_SEPARATOR)
+        return true;
+    errno = EINVAL;
+    return false;
+}
+
+/**
+ * Parses JSON into callbacks without building a tree
+ *
+ * @param source
+ * @param length
+ * @param sax
+ * @param user
+ * @return true | false
+ */
+bool utjson_parseEvents(const char *source, size_t length, const utjson_sax *sax, void *user)
+{
+    if (!source || !sax)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    sax_context ctx = {
+        .source = source,
+        .length = length,
+        .sax = sax,
+        .user = user,
+        .allocated = sizeof(ctx.local),
+        .muted = SIZE_MAX,
+    };
+    ctx.kinds = ctx.local;
+    if (!utjson_structuralInit(&ctx.index, source, length))
+        return false;
+
+    bool result = sax_run(&ctx);
+
+    utjson_structuralFree(&ctx.index);
+    if (ctx.kinds != ctx.local)
+    {
+        free(ctx.kinds);
+    }
+    return result;
+}
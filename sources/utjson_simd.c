@@ -0,0 +1,619 @@
+#include "utjson_simd.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define UTJSON_X86 1
+#endif
+
+/**
+ * Character classes of one 64-byte block, one bit per byte
+ */
+typedef struct
+{
+    uint64_t whitespace;  /**< ' ', \t, \n, \r */
+    uint64_t operators;   /**< {}[]:, */
+    uint64_t quotes;      /**< " (escaped or not) */
+    uint64_t backslashes; /**< \ */
+} block_masks;
+
+enum
+{
+    CLASS_WHITESPACE = 1,
+    CLASS_OPERATOR = 2,
+    CLASS_QUOTE = 4,
+    CLASS_BACKSLASH = 8,
+};
+
+static const uint8_t character_class[256] = {
+    [' '] = CLASS_WHITESPACE,
+    ['\t'] = CLASS_WHITESPACE,
+    ['\n'] = CLASS_WHITESPACE,
+    ['\r'] = CLASS_WHITESPACE,
+    ['{'] = CLASS_OPERATOR,
+    ['}'] = CLASS_OPERATOR,
+    ['['] = CLASS_OPERATOR,
+    [']'] = CLASS_OPERATOR,
+    [':'] = CLASS_OPERATOR,
+    [','] = CLASS_OPERATOR,
+    ['"'] = CLASS_QUOTE,
+    ['\\'] = CLASS_BACKSLASH,
+};
+
+static void classify_scalar(const char *block, block_masks *masks)
+{
+    uint64_t whitespace = 0, operators = 0, quotes = 0, backslashes = 0;
+    for (int i = 0; i < utjson_STRUCTURAL_BLOCK; i++)
+    {
+        uint64_t class = character_class[(uint8_t)block[i]];
+        whitespace |= (class & 1) << i;
+        operators |= ((class >> 1) & 1) << i;
+        quotes |= ((class >> 2) & 1) << i;
+        backslashes |= ((class >> 3) & 1) << i;
+    }
+    masks->whitespace = whitespace;
+    masks->operators = operators;
+    masks->quotes = quotes;
+    masks->backslashes = backslashes;
+}
+
+#ifdef UTJSON_X86
+static void classify_sse2(const char *block, block_masks *masks)
+{
+    memset(masks, 0, sizeof(block_masks));
+    for (int i = 0; i < 4; i++)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+        // '[' and ']' differ from '{' and '}' only in bit 0x20
+        __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+        __m128i operators = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(':')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(','))));
+        __m128i whitespace = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+        int shift = 16 * i;
+        masks->operators |= (uint64_t)(uint16_t)_mm_movemask_epi8(operators) << shift;
+        masks->whitespace |= (uint64_t)(uint16_t)_mm_movemask_epi8(whitespace) << shift;
+        masks->quotes |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'))) << shift;
+        masks->backslashes |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))) << shift;
+    }
+}
+
+__attribute__((target("avx2"))) static void classify_avx2(const char *block, block_masks *masks)
+{
+    memset(masks, 0, sizeof(block_masks));
+    for (int i = 0; i < 2; i++)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(block + 32 * i));
+        __m256i folded = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+        __m256i operators = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(','))));
+        __m256i whitespace = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'))));
+        int shift = 32 * i;
+        masks->operators |= (uint64_t)(uint32_t)_mm256_movemask_epi8(operators) << shift;
+        masks->whitespace |= (uint64_t)(uint32_t)_mm256_movemask_epi8(whitespace) << shift;
+        masks->quotes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'))) << shift;
+        masks->backslashes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))) << shift;
+    }
+}
+#endif
+
+// bytes a JSON string cannot hold as they are: '"', '\\' and control characters
+static const bool needs_escape[256] = {
+    [0 ... 0x1F] = true,
+    ['"'] = true,
+    ['\\'] = true,
+};
+
+static size_t string_span_scalar(const char *text, size_t length)
+{
+    size_t i = 0;
+    while (i < length && text[i] != '"' && text[i] != '\\')
+        i++;
+    return i;
+}
+
+static size_t escape_span_scalar(const char *text, size_t length)
+{
+    size_t i = 0;
+    while (i < length && !needs_escape[(uint8_t)text[i]])
+        i++;
+    return i;
+}
+
+#ifdef UTJSON_X86
+static size_t string_span_sse2(const char *text, size_t length)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(text + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + string_span_scalar(text + i, length - i);
+}
+
+__attribute__((target("avx2"))) static size_t string_span_avx2(const char *text, size_t length)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(text + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)));
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + string_span_sse2(text + i, length - i);
+}
+
+static size_t escape_span_sse2(const char *text, size_t length)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(text + i));
+        // unsigned chunk <= 0x1F exactly where max(chunk, 0x1F) stays 0x1F
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+        unsigned mask = (unsigned)_mm_movemask_epi8(special);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + escape_span_scalar(text + i, length - i);
+}
+
+__attribute__((target("avx2"))) static size_t escape_span_avx2(const char *text, size_t length)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i special = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, control), control));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(special);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + escape_span_sse2(text + i, length - i);
+}
+#endif
+
+// lead byte classes of well-formed UTF-8 (RFC 3629, table 3-7 of Unicode)
+enum
+{
+    UTF8_INVALID,
+    UTF8_ASCII,
+    UTF8_TWO,         /**< C2..DF 80..BF */
+    UTF8_THREE_E0,    /**< E0 A0..BF 80..BF */
+    UTF8_THREE,       /**< E1..EC, EE..EF 80..BF 80..BF */
+    UTF8_THREE_ED,    /**< ED 80..9F 80..BF */
+    UTF8_FOUR_F0,     /**< F0 90..BF 80..BF 80..BF */
+    UTF8_FOUR,        /**< F1..F3 80..BF 80..BF 80..BF */
+    UTF8_FOUR_F4,     /**< F4 80..8F 80..BF 80..BF */
+};
+
+static const uint8_t utf8_lead[256] = {
+    [0x00 ... 0x7F] = UTF8_ASCII,
+    [0xC2 ... 0xDF] = UTF8_TWO,
+    [0xE0] = UTF8_THREE_E0,
+    [0xE1 ... 0xEC] = UTF8_THREE,
+    [0xED] = UTF8_THREE_ED,
+    [0xEE ... 0xEF] = UTF8_THREE,
+    [0xF0] = UTF8_FOUR_F0,
+    [0xF1 ... 0xF3] = UTF8_FOUR,
+    [0xF4] = UTF8_FOUR_F4,
+};
+
+#define utf8_continuation(c) (((c) & 0xC0) == 0x80)
+
+// length of the well-formed sequence at text, 0 if there is none
+static size_t utf8_sequence(const uint8_t *text, size_t length)
+{
+    uint8_t lead = utf8_lead[text[0]];
+    size_t size = lead == UTF8_ASCII ? 1 : lead == UTF8_TWO ? 2 : lead <= UTF8_THREE_ED ? 3 : 4;
+    if (lead == UTF8_INVALID || size > length)
+        return 0;
+    if (size == 1)
+        return 1;
+    uint8_t second = text[1];
+    bool valid = lead == UTF8_THREE_E0   ? second >= 0xA0 && second <= 0xBF
+                 : lead == UTF8_THREE_ED ? second >= 0x80 && second <= 0x9F
+                 : lead == UTF8_FOUR_F0  ? second >= 0x90 && second <= 0xBF
+                 : lead == UTF8_FOUR_F4  ? second >= 0x80 && second <= 0x8F
+                                         : utf8_continuation(second);
+    for (size_t i = 2; valid && i < size; i++)
+    {
+        valid = utf8_continuation(text[i]);
+    }
+    return valid ? size : 0;
+}
+
+static bool utf8_valid_scalar(const char *text, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)text;
+    size_t i = 0;
+    while (i < length)
+    {
+        if (bytes[i] < 0x80)
+        {
+            i++;
+            continue;
+        }
+        size_t size = utf8_sequence(bytes + i, length - i);
+        if (!size)
+            return false;
+        i += size;
+    }
+    return true;
+}
+
+#ifdef UTJSON_X86
+static bool utf8_valid_sse2(const char *text, size_t length)
+{
+    // ASCII runs go 16 bytes at a time, the rest one sequence at a time
+    const uint8_t *bytes = (const uint8_t *)text;
+    size_t i = 0;
+    while (i < length)
+    {
+        if (i + 16 <= length && !_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(bytes + i))))
+        {
+            i += 16;
+            continue;
+        }
+        size_t size = utf8_sequence(bytes + i, length - i);
+        if (!size)
+            return false;
+        i += size;
+    }
+    return true;
+}
+
+/*
+ * Lookup validator: every byte is checked against the three bytes before it
+ * with three 16-entry tables indexed by nibbles, so a block needs no
+ * branches. Each table entry is a set of error bits, and a byte pair is
+ * invalid where all three lookups share one.
+ */
+#define UTF8_TOO_SHORT (1 << 0)  /**< lead byte followed by a lead or ASCII byte */
+#define UTF8_TOO_LONG (1 << 1)   /**< ASCII followed by a continuation */
+#define UTF8_OVERLONG_3 (1 << 2) /**< E0 80..9F */
+#define UTF8_TOO_LARGE (1 << 3)  /**< F4 90..BF, F5.. */
+#define UTF8_SURROGATE (1 << 4)  /**< ED A0..BF */
+#define UTF8_OVERLONG_2 (1 << 5) /**< C0, C1 */
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4 (1 << 6) /**< F0 80..8F */
+#define UTF8_TWO_CONTS (1 << 7)  /**< continuation after continuation */
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+__attribute__((target("avx2"))) static __m256i utf8_table(char e0, char e1, char e2, char e3, char e4, char e5, char e6,
+                                                          char e7, char e8, char e9, char e10, char e11, char e12,
+                                                          char e13, char e14, char e15)
+{
+    return _mm256_setr_epi8(e0, e1, e2, e3, e4, e5, e6, e7, e8, e9, e10, e11, e12, e13, e14, e15, e0, e1, e2, e3, e4,
+                            e5, e6, e7, e8, e9, e10, e11, e12, e13, e14, e15);
+}
+
+// input shifted right by count bytes, the last bytes of previous filling in
+#define utf8_previous(input, previous, count) \
+    _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - (count))
+
+__attribute__((target("avx2"))) static bool utf8_valid_avx2(const char *text, size_t length)
+{
+    const __m256i byte_1_high = utf8_table(
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TOO_LONG, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4);
+    const __m256i byte_1_low = utf8_table(
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4, UTF8_CARRY | UTF8_OVERLONG_2, UTF8_CARRY,
+        UTF8_CARRY, UTF8_CARRY | UTF8_TOO_LARGE, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000);
+    const __m256i byte_2_high = utf8_table(
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    // only bytes E0.. two back and F0.. three back reach 0x80 after these subtractions
+    const __m256i third = _mm256_set1_epi8((char)(0xE0 - 0x80));
+    const __m256i fourth = _mm256_set1_epi8((char)(0xF0 - 0x80));
+
+    __m256i previous = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+    bool previous_ascii = true;
+    size_t i = 0;
+    // the zero-padded tail always runs, so a sequence cut by the end shows up as too short
+    for (bool tail = false; !tail; i += 32)
+    {
+        __m256i input;
+        if (i + 32 <= length)
+        {
+            input = _mm256_loadu_si256((const __m256i *)(text + i));
+        }
+        else
+        {
+            char padded[32] = {0};
+            memcpy(padded, text + i, length - i);
+            input = _mm256_loadu_si256((const __m256i *)padded);
+            tail = true;
+        }
+
+        bool ascii = !_mm256_movemask_epi8(input);
+        if (!(ascii && previous_ascii))
+        {
+            __m256i previous_1 = utf8_previous(input, previous, 1);
+            __m256i special = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(previous_1, 4), nibble)),
+                    _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(previous_1, nibble))),
+                _mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+            __m256i must_continue =
+                _mm256_or_si256(_mm256_subs_epu8(utf8_previous(input, previous, 2), third),
+                                _mm256_subs_epu8(utf8_previous(input, previous, 3), fourth));
+            must_continue = _mm256_and_si256(must_continue, _mm256_set1_epi8((char)0x80));
+            error = _mm256_or_si256(error, _mm256_xor_si256(must_continue, special));
+            if ((i & 1023) == 0 && !_mm256_testz_si256(error, error))
+                return false;
+        }
+        previous = input;
+        previous_ascii = ascii;
+    }
+    return _mm256_testz_si256(error, error);
+}
+#endif
+
+static void (*classify)(const char *block, block_masks *masks) = classify_scalar;
+static size_t (*string_span)(const char *text, size_t length) = string_span_scalar;
+static size_t (*escape_span)(const char *text, size_t length) = escape_span_scalar;
+static bool (*utf8_valid)(const char *text, size_t length) = utf8_valid_scalar;
+static const char *simd_level = "scalar";
+
+__attribute__((constructor)) static void simd_select(void)
+{
+#ifdef UTJSON_X86
+    __builtin_cpu_init();
+    if (!getenv("UTJSON_NO_SIMD"))
+    {
+        if (__builtin_cpu_supports("avx2"))
+        {
+            classify = classify_avx2;
+            string_span = string_span_avx2;
+            escape_span = escape_span_avx2;
+            utf8_valid = utf8_valid_avx2;
+            simd_level = "avx2";
+        }
+        else if (__builtin_cpu_supports("sse2"))
+        {
+            classify = classify_sse2;
+            string_span = string_span_sse2;
+            escape_span = escape_span_sse2;
+            utf8_valid = utf8_valid_sse2;
+            simd_level = "sse2";
+        }
+    }
+#endif
+}
+
+/**
+ * Instruction set used by the kernels
+ *
+ * @return const char*
+ */
+const char *utjson_simdLevel(void)
+{
+    return simd_level;
+}
+
+/**
+ * Length of the prefix of a string body without quote or backslash
+ *
+ * @param text
+ * @param length
+ * @return size_t
+ */
+size_t utjson_stringSpan(const char *text, size_t length)
+{
+    return string_span(text, length);
+}
+
+/**
+ * Length of the prefix of text that needs no escaping in a JSON string
+ *
+ * @param text
+ * @param length
+ * @return size_t
+ */
+size_t utjson_escapeSpan(const char *text, size_t length)
+{
+    return escape_span(text, length);
+}
+
+/**
+ * Whether text is well-formed UTF-8 (no overlongs, surrogates or code points past U+10FFFF)
+ *
+ * @param text
+ * @param length
+ * @return true | false
+ */
+bool utjson_utf8Valid(const char *text, size_t length)
+{
+    return utf8_valid(text, length);
+}
+
+static uint64_t prefix_xor(uint64_t bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+static void index_block(utjson_structural *index, const char *block, uint32_t offset)
+{
+    block_masks masks;
+    classify(block, &masks);
+
+    // a backslash escapes the next byte unless it is escaped itself
+    uint64_t escaped = index->escaped;
+    uint64_t backslashes = masks.backslashes & ~escaped;
+    index->escaped = 0;
+    while (backslashes)
+    {
+        int bit = __builtin_ctzll(backslashes);
+        if (bit == 63)
+        {
+            index->escaped = 1;
+            break;
+        }
+        escaped |= 1ULL << (bit + 1);
+        backslashes &= ~(1ULL << (bit + 1));
+        backslashes &= backslashes - 1;
+    }
+
+    uint64_t quotes = masks.quotes & ~escaped;
+    // opening quote and string content are inside, the closing quote is not
+    uint64_t in_string = prefix_xor(quotes) ^ index->in_string;
+    index->in_string = (uint64_t)((int64_t)in_string >> 63);
+
+    uint64_t delimiters = masks.whitespace | masks.operators | quotes;
+    uint64_t follows = (delimiters << 1) | index->follows;
+    index->follows = delimiters >> 63;
+
+    uint64_t scalars = ~(delimiters | in_string);
+    uint64_t structurals = (masks.operators & ~in_string) | quotes | (scalars & follows);
+    while (structurals)
+    {
+        index->positions[index->count++] = offset + (uint32_t)__builtin_ctzll(structurals);
+        structurals &= structurals - 1;
+    }
+}
+
+static bool structural_fill(utjson_structural *index)
+{
+    index->count = 0;
+    index->cursor = 0;
+    if (index->next >= index->length)
+        return false;
+
+    index->base = index->next;
+    size_t stop = index->length - index->base > utjson_STRUCTURAL_WINDOW
+                      ? index->base + utjson_STRUCTURAL_WINDOW
+                      : index->length;
+    while (index->next + utjson_STRUCTURAL_BLOCK <= stop)
+    {
+        index_block(index, index->source + index->next, (uint32_t)(index->next - index->base));
+        index->next += utjson_STRUCTURAL_BLOCK;
+    }
+    if (index->next < stop)
+    {
+        // the last partial block is padded with whitespace, which never yields a position
+        char padded[utjson_STRUCTURAL_BLOCK];
+        memset(padded, ' ', sizeof(padded));
+        memcpy(padded, index->source + index->next, stop - index->next);
+        index_block(index, padded, (uint32_t)(index->next - index->base));
+        index->next = stop;
+    }
+    return true;
+}
+
+/**
+ * Prepares the index over source
+ *
+ * @param index
+ * @param source
+ * @param length
+ * @return true | false
+ */
+bool utjson_structuralInit(utjson_structural *index, const char *source, size_t length)
+{
+    memset(index, 0, sizeof(utjson_structural));
+    index->source = source;
+    index->length = length;
+    index->follows = 1; // the document may start with a literal
+    index->positions = malloc(utjson_STRUCTURAL_WINDOW * sizeof(uint32_t));
+    if (!index->positions)
+    {
+        errno = ENOMEM;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Offset of the next structural character, or SIZE_MAX at the end
+ *
+ * @param index
+ * @return size_t
+ */
+size_t utjson_structuralNext(utjson_structural *index)
+{
+    size_t position = utjson_structuralPeek(index);
+    if (position != SIZE_MAX)
+    {
+        index->cursor++;
+    }
+    return position;
+}
+
+/**
+ * Offset of the next structural character without consuming it
+ *
+ * @param index
+ * @return size_t
+ */
+size_t utjson_structuralPeek(utjson_structural *index)
+{
+    while (index->cursor >= index->count)
+    {
+        if (!structural_fill(index))
+            return SIZE_MAX;
+    }
+    return index->base + index->positions[index->cursor];
+}
+
+/**
+ * Releases the index
+ *
+ * @param index
+ */
+void utjson_structuralFree(utjson_structural *index)
+{
+    if (index->positions)
+    {
+        free(index->positions);
+        index->positions = NULL;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef UTJSON_SIMD_H
+#define UTJSON_SIMD_H
+
+/**
+ * Internal vectorized kernels of the parser (not part of the public API)
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define utjson_STRUCTURAL_BLOCK 64
+#define utjson_STRUCTURAL_WINDOW (32 * 1024) /**< Input bytes indexed per refill */
+
+/**
+ * @brief Stage one of the indexed parser.
+ *
+ * Yields the offsets of structural characters ({}[]:,) outside strings, of
+ * every unescaped quote and of the first byte of every number or literal,
+ * one window of input at a time so the index stays cache-sized.
+ */
+typedef struct utjson_structural
+{
+    const char *source; /**< Indexed input */
+    size_t length;      /**< Input length */
+    size_t base;        /**< Offset the positions are relative to */
+    size_t next;        /**< Offset of the first block not indexed yet */
+    uint32_t *positions; /**< Offsets found in the current window */
+    size_t count;       /**< Number of positions */
+    size_t cursor;      /**< Next position to hand out */
+    uint64_t in_string; /**< All ones if the last block ended inside a string */
+    uint64_t escaped;   /**< 1 if the last block ended with a pending backslash */
+    uint64_t follows;   /**< 1 if the last block ended with a delimiter */
+} utjson_structural;
+
+bool utjson_structuralInit(utjson_structural *index, const char *source, size_t length);
+size_t utjson_structuralNext(utjson_structural *index);
+size_t utjson_structuralPeek(utjson_structural *index);
+void utjson_structuralFree(utjson_structural *index);
+
+/**
+ * @brief Length of the prefix of a string body before the first '"' or '\\' (length if there is none).
+ */
+size_t utjson_stringSpan(const char *text, size_t length);
+
+/**
+ * @brief Length of the prefix of text a JSON string holds as is, i.e. up to the first '"', '\\' or control character.
+ */
+size_t utjson_escapeSpan(const char *text, size_t length);
+
+/**
+ * @brief Whether text is well-formed UTF-8 (RFC 3629: no overlongs, surrogates or code points past U+10FFFF).
+ */
+bool utjson_utf8Valid(const char *text, size_t length);
+
+/**
+ * @brief Name of the instruction set selected at runtime ("avx2", "sse2" or "scalar").
+ */
+const char *utjson_simdLevel(void);
+
+#endif // UTJSON_SIMD_H
@@ -0,0 +1,330 @@
+#include "utjson_internal.h"
+#include <errno.h>
+
+/**
+ * Where the lexer is inside the current token
+ */
+typedef enum
+{
+    LEX_IDLE,   /**< Between tokens */
+    LEX_STRING, /**< Inside a string */
+    LEX_ESCAPE, /**< Right after a backslash inside a string */
+    LEX_ATOM,   /**< Inside a number or literal */
+} stream_lex;
+
+/**
+ * What the parser expects from the next token
+ */
+typedef enum
+{
+    EXPECT_VALUE,        /**< Any value */
+    EXPECT_VALUE_OR_END, /**< First element of an array or ']' */
+    EXPECT_KEY,          /**< Member key */
+    EXPECT_KEY_OR_END,   /**< First member key of an object or '}' */
+    EXPECT_COLON,        /**< ':' after a member key */
+    EXPECT_SEPARATOR,    /**< ',' or the end of the current container */
+    EXPECT_NOTHING,      /**< The document is complete, only whitespace may follow */
+} stream_expect;
+
+/**
+ * Resumable parser state, kept across utjson_parserFeed() calls
+ */
+struct utjson_parser
+{
+    parse_context ctx;    /**< Scalar decoding and key building */
+    utjson_buffer token;  /**< Bytes of the unfinished token */
+    utjson_buffer key;    /**< Raw name of the member being parsed */
+    stream_lex lex;       /**< Lexer state */
+    stream_expect expect; /**< Grammar state */
+    utjson *root;         /**< Document being built */
+    utjson **stack;       /**< Open containers, innermost last */
+    size_t depth;         /**< Number of open containers */
+    size_t allocated;     /**< Capacity of stack */
+    bool failed;          /**< A syntax or allocation error occurred */
+};
+
+#define is_json_whitespace(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+#define is_json_delimiter(c) (is_json_whitespace(c) || (c) == ',' || (c) == ':' || (c) == ']' || (c) == '}' || \
+                              (c) == '[' || (c) == '{' || (c) == '"')
+
+static bool token_append(utjson_buffer *buffer, const char *data, size_t length)
+{
+    if (!utjson_bufferReserve(buffer, length))
+        return false;
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    return true;
+}
+
+static utjson *stream_container(utjson_parser *parser)
+{
+    return parser->depth ? parser->stack[parser->depth - 1] : NULL;
+}
+
+static bool stream_attach(utjson_parser *parser, utjson *value)
+{
+    utjson *container = stream_container(parser);
+    if (!container)
+    {
+        parser->root = value;
+        return true;
+    }
+    if (utjson_IS(ARRAY, container))
+        return utjson_add(container, value) != NULL;
+
+    char *name = utjson_parseKey(&parser->ctx, parser->key.data, parser->key.length);
+    return name && utjson_setMember(container, name, value, 0);
+}
+
+static void stream_close(utjson_parser *parser)
+{
+    parser->depth--;
+    parser->expect = parser->depth ? EXPECT_SEPARATOR : EXPECT_NOTHING;
+}
+
+static bool stream_value(utjson_parser *parser, utjson *value)
+{
+    if (!value || !stream_attach(parser, value))
+    {
+        if (value && value != parser->root)
+        {
+            utjson_destruct(value);
+        }
+        return false;
+    }
+    parser->expect = parser->depth ? EXPECT_SEPARATOR : EXPECT_NOTHING;
+    return true;
+}
+
+static bool stream_open(utjson_parser *parser, utjson *container)
+{
+    if (!stream_value(parser, container))
+        return false;
+    if (parser->depth == parser->allocated)
+    {
+        size_t allocated = parser->allocated ? parser->allocated * 2 : utjson_ARRAY_INCREMENT;
+        utjson **stack = realloc(parser->stack, allocated * sizeof(utjson *));
+        if (!stack)
+        {
+            errno = ENOMEM;
+            return false;
+        }
+        parser->stack = stack;
+        parser->allocated = allocated;
+    }
+    parser->stack[parser->depth++] = container;
+    parser->expect = utjson_IS(ARRAY, container) ? EXPECT_VALUE_OR_END : EXPECT_KEY_OR_END;
+    return true;
+}
+
+static bool stream_token(utjson_parser *parser)
+{
+    utjson_buffer *token = &parser->token;
+    if (parser->expect == EXPECT_KEY || parser->expect == EXPECT_KEY_OR_END)
+    {
+        // a key is kept raw (without quotes) until its value is complete
+        if (token->data[0] != '"')
+            return false;
+        parser->key.length = 0;
+        if (!token_append(&parser->key, token->data + 1, token->length - 2))
+            return false;
+        parser->expect = EXPECT_COLON;
+        return true;
+    }
+    if (parser->expect != EXPECT_VALUE && parser->expect != EXPECT_VALUE_OR_END)
+        return false;
+
+    parser->ctx.cursor = token->data;
+    parser->ctx.end = token->data + token->length;
+    utjson *value = utjson_parseValue(&parser->ctx);
+    if (value && parser->ctx.cursor != parser->ctx.end)
+    {
+        value = utjson_destruct(value); // trailing garbage inside the token
+    }
+    return stream_value(parser, value);
+}
+
+static bool stream_structural(utjson_parser *parser, char c)
+{
+    switch (c)
+    {
+    case '{':
+    case '[':
+        if (parser->expect != EXPECT_VALUE && parser->expect != EXPECT_VALUE_OR_END)
+            return false;
+        return stream_open(parser, c == '{' ? utjson_createObjectIn(parser->ctx.arena)
+                                            : utjson_createArrayIn(parser->ctx.arena));
+    case '}':
+        if ((parser->expect != EXPECT_SEPARATOR && parser->expect != EXPECT_KEY_OR_END) ||
+            !utjson_IS(OBJECT, stream_container(parser)))
+            return false;
+        stream_close(parser);
+        return true;
+    case ']':
+        if ((parser->expect != EXPECT_SEPARATOR && parser->expect != EXPECT_VALUE_OR_END) ||
+            !utjson_IS(ARRAY, stream_container(parser)))
+            return false;
+        stream_close(parser);
+        return true;
+    case ',':
+        if (parser->expect != EXPECT_SEPARATOR)
+            return false;
+        parser->expect = utjson_IS(ARRAY, stream_container(parser)) ? EXPECT_VALUE : EXPECT_KEY;
+        return true;
+    case ':':
+        if (parser->expect != EXPECT_COLON)
+            return false;
+        parser->expect = EXPECT_VALUE;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Creates a push parser whose document goes into the arena
+ *
+ * @param arena
+ * @param flags
+ * @return utjson_parser*
+ */
+utjson_parser *utjson_parserNewIn(utjson_arena *arena, unsigned flags)
+{
+    utjson_parser *parser = calloc(1, sizeof(utjson_parser));
+    if (!parser)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    parser->ctx.arena = arena;
+    parser->ctx.integers = flags & utjson_PARSE_INTEGERS; // chunks are always copied, the engine flags do not apply
+    parser->ctx.validate_utf8 = flags & utjson_PARSE_VALIDATE_UTF8;
+    parser->lex = LEX_IDLE;
+    parser->expect = EXPECT_VALUE;
+    return parser;
+}
+
+/**
+ * Creates a push parser
+ *
+ * @param flags
+ * @return utjson_parser*
+ */
+utjson_parser *utjson_parserNew(unsigned flags)
+{
+    return utjson_parserNewIn(NULL, flags);
+}
+
+/**
+ * Consumes the next chunk of the document
+ *
+ * @param parser
+ * @param chunk
+ * @param length
+ * @return true | false
+ */
+bool utjson_parserFeed(utjson_parser *parser, const char *chunk, size_t length)
+{
+    if (!parser || (!chunk && length))
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    size_t i = 0;
+    while (!parser->failed && i < length)
+    {
+        switch (parser->lex)
+        {
+        case LEX_IDLE:
+        {
+            char c = chunk[i];
+            if (is_json_whitespace(c))
+            {
+                i++;
+            }
+            else if (c == '"' || !is_json_delimiter(c))
+            {
+                parser->token.length = 0;
+                parser->lex = c == '"' ? LEX_STRING : LEX_ATOM;
+                if (c == '"')
+                {
+                    parser->failed = !token_append(&parser->token, chunk + i++, 1);
+                }
+            }
+            else
+            {
+                parser->failed = !stream_structural(parser, c);
+                i++;
+            }
+            break;
+        }
+        case LEX_STRING:
+        {
+            // copy the run up to the next quote or backslash in one go
+            size_t start = i;
+            while (i < length && chunk[i] != '"' && chunk[i] != '\\')
+                i++;
+            if (i < length)
+            {
+                parser->lex = chunk[i] == '"' ? LEX_IDLE : LEX_ESCAPE;
+                i++;
+            }
+            parser->failed = !token_append(&parser->token, chunk + start, i - start) ||
+                             (parser->lex == LEX_IDLE && !stream_token(parser));
+            break;
+        }
+        case LEX_ESCAPE:
+            parser->failed = !token_append(&parser->token, chunk + i++, 1);
+            parser->lex = LEX_STRING;
+            break;
+        case LEX_ATOM:
+        {
+            size_t start = i;
+            while (i < length && !is_json_delimiter(chunk[i]))
+                i++;
+            parser->failed = !token_append(&parser->token, chunk + start, i - start);
+            if (!parser->failed && i < length)
+            {
+                // the delimiter is handled as the next token
+                parser->lex = LEX_IDLE;
+                parser->failed = !stream_token(parser);
+            }
+            break;
+        }
+        }
+    }
+    return !parser->failed;
+}
+
+/**
+ * Completes the document and releases the parser
+ *
+ * @param parser
+ * @return utjson*
+ */
+utjson *utjson_parserFinish(utjson_parser *parser)
+{
+    if (!parser)
+        return NULL;
+
+    if (!parser->failed && parser->lex == LEX_ATOM)
+    {
+        // a number or literal may end with the input
+        parser->lex = LEX_IDLE;
+        parser->failed = !stream_token(parser);
+    }
+
+    utjson *root = parser->root;
+    if (parser->failed || parser->lex != LEX_IDLE || parser->expect != EXPECT_NOTHING)
+    {
+        root = utjson_destruct(root);
+        errno = EINVAL;
+    }
+
+    utjson_bufferFree(&parser->token);
+    utjson_bufferFree(&parser->key);
+    utjson_bufferFree(&parser->ctx.scratch);
+    free(parser->stack);
+    free(parser);
+    return root;
+}
@@ -0,0 +1,170 @@
+#include "utjson_internal.h"
+#include "utjson_simd.h"
+
+/**
+ * Appends a code point as UTF-8
+ *
+ * @param out room for up to 4 bytes
+ * @param code
+ * @return char* past the last byte written
+ */
+char *utjson_utf8Put(char *out, unsigned code)
+{
+    if (code < 0x80)
+    {
+        *out++ = (char)code;
+    }
+    else if (code < 0x800)
+    {
+        *out++ = (char)(0xC0 | code >> 6);
+        *out++ = (char)(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
+    {
+        *out++ = (char)(0xE0 | code >> 12);
+        *out++ = (char)(0x80 | (code >> 6 & 0x3F));
+        *out++ = (char)(0x80 | (code & 0x3F));
+    }
+    else
+    {
+        *out++ = (char)(0xF0 | code >> 18);
+        *out++ = (char)(0x80 | (code >> 12 & 0x3F));
+        *out++ = (char)(0x80 | (code >> 6 & 0x3F));
+        *out++ = (char)(0x80 | (code & 0x3F));
+    }
+    return out;
+}
+
+/**
+ * Reads the four hex digits of a \\u escape
+ *
+ * @param text
+ * @param code
+ * @return bool
+ */
+bool utjson_hex4(const char *text, unsigned *code)
+{
+    *code = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        char c = text[i];
+        unsigned digit = (c >= '0' && c <= '9')   ? (unsigned)(c - '0')
+                         : (c >= 'a' && c <= 'f') ? (unsigned)(c - 'a' + 10)
+                         : (c >= 'A' && c <= 'F') ? (unsigned)(c - 'A' + 10)
+                                                  : 16;
+        if (digit > 15)
+            return false;
+        *code = *code << 4 | digit;
+    }
+    return true;
+}
+
+// decodes the \u escape at text (past the 'u'), a surrogate pair included
+static const char *unescape_unicode(const char *text, const char *end, char **out)
+{
+    unsigned code;
+    if (end - text < 4 || !utjson_hex4(text, &code))
+        return NULL;
+    text += 4;
+    if (code >= 0xD800 && code < 0xDC00)
+    {
+        unsigned low;
+        if (end - text < 6 || text[0] != '\\' || text[1] != 'u' || !utjson_hex4(text + 2, &low) || low < 0xDC00 ||
+            low > 0xDFFF)
+            return NULL;
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        text += 6;
+    }
+    else if (code >= 0xDC00 && code <= 0xDFFF)
+    {
+        return NULL; // a low surrogate without its high half
+    }
+    *out = utjson_utf8Put(*out, code);
+    return text;
+}
+
+/**
+ * Decodes the escapes of a JSON string body
+ *
+ * Runs without escapes move in bulk. Decoding never lengthens the text,
+ * so out may be text itself.
+ *
+ * @param out room for length bytes
+ * @param text body between the quotes
+ * @param length
+ * @return size_t decoded length, SIZE_MAX on a malformed escape
+ */
+size_t utjson_unescape(char *out, const char *text, size_t length)
+{
+    const char *end = text + length;
+    char *start = out;
+    while (text < end)
+    {
+        const char *slash = memchr(text, '\\', end - text);
+        size_t run = (slash ? slash : end) - text;
+        if (out != text)
+        {
+            memmove(out, text, run);
+        }
+        out += run;
+        if (!slash)
+            break;
+        if (slash + 1 == end)
+            return SIZE_MAX;
+        text = slash + 2;
+        switch (slash[1])
+        {
+        case '"':
+        case '\\':
+        case '/':
+            *out++ = slash[1];
+            break;
+        case 'b':
+            *out++ = '\b';
+            break;
+        case 'f':
+            *out++ = '\f';
+            break;
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 'r':
+            *out++ = '\r';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case 'u':
+            text = unescape_unicode(text, end, &out);
+            if (!text)
+                return SIZE_MAX;
+            break;
+        default:
+            return SIZE_MAX;
+        }
+    }
+    return out - start;
+}
+
+/**
+ * Finds the closing quote of a string body, stepping over escaped bytes
+ *
+ * @param text first byte past the opening quote
+ * @param end
+ * @return char* the closing quote, NULL if the string is unterminated
+ */
+char *utjson_stringEnd(char *text, const char *end)
+{
+    for (;;)
+    {
+        text += utjson_stringSpan(text, end - text);
+        if (text >= end)
+            return NULL;
+        if (*text == '"')
+            return text;
+        // the escaped byte never closes the string
+        text += 2;
+        if (text > end)
+            return NULL;
+    }
+}